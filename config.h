@@ -21,3 +21,8 @@
 #define DEFNMASTER		1	/* number of windows in master area */
 #define SNAP			5	/* snap pixel */
 #define DECORATETILED		0	/* set to 1 to draw titles in tiled layouts */
+#define TITLEREAP		30	/* seconds a hidden title keeps its resources */
+#define FRAMEPOOL		8	/* unmanaged frames kept for reuse */
+#define RATELIMIT		20	/* titles, hints or configures per second per client */
+#define TITLERATE		10	/* title redraws per second per client */
+#define MAXTAGS			64	/* most desktops a pager or tags.number may ask for */
@@ -9,6 +9,7 @@ BINPREFIX?= ${PREFIX}/bin
 MANPREFIX?= ${PREFIX}/share/man
 CONFPREFIX?= ${PREFIX}/share/examples
 DOCPREFIX?= ${PREFIX}/share/doc
+INCPREFIX?= ${PREFIX}/include
 CONF?= ${CONFPREFIX}
 
 X11INC?= /usr/X11R6/include
@@ -34,6 +35,9 @@ LDFLAGS = -g3 -ggdb3 ${LIBS}
 #CFLAGS += -Werror        # Treat warnings as errors.
 #CFLAGS += -save-temps    # Keep precompiler output (great for debugging).
 
+# shm_open() for the state snapshot is in librt with glibc before 2.34.
+#LIBS += -lrt
+
 # XRandr (multihead support). Comment out to disable.
 CFLAGS += -DXRANDR=1
 LIBS += -lXrandr
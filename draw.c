@@ -100,32 +100,32 @@ drawelement(char which, int x, int position, Client *c) {
 		w = 0;
 		for (j = 0; j < ntags; j++) {
 			if (c->tags[j])
-				w += drawtext(tags[j], c->drawable, c->xftdraw,
+				w += drawtext(tags[j], c->cold->drawable, c->cold->xftdraw,
 				    color, dc.x, dc.y, dc.w);
 		}
 		break;
 	case '|':
 		XSetForeground(dpy, dc.gc, color[ColBorder]);
-		XDrawLine(dpy, c->drawable, dc.gc, dc.x + dc.h / 4, 0,
+		XDrawLine(dpy, c->cold->drawable, dc.gc, dc.x + dc.h / 4, 0,
 		    dc.x + dc.h / 4, dc.h);
 		w = dc.h / 2;
 		break;
 	case 'N':
-		w = drawtext(c->name, c->drawable, c->xftdraw, color, dc.x, dc.y, dc.w);
+		w = drawtext(c->cold->name, c->cold->drawable, c->cold->xftdraw, color, dc.x, dc.y, dc.w);
 		break;
 	case 'I':
 		button[Iconify].x = dc.x;
-		w = drawbutton(c->drawable, button[Iconify], color,
+		w = drawbutton(c->cold->drawable, button[Iconify], color,
 		    dc.x, dc.h / 2 - button[Iconify].ph / 2);
 		break;
 	case 'M':
 		button[Maximize].x = dc.x;
-		w = drawbutton(c->drawable, button[Maximize], color,
+		w = drawbutton(c->cold->drawable, button[Maximize], color,
 		    dc.x, dc.h / 2 - button[Maximize].ph / 2);
 		break;
 	case 'C':
 		button[Close].x = dc.x;
-		w = drawbutton(c->drawable, button[Close], color, dc.x,
+		w = drawbutton(c->cold->drawable, button[Close], color, dc.x,
 		    dc.h / 2 - button[Maximize].ph / 2);
 		break;
 	default:
@@ -146,7 +146,7 @@ elementw(char which, Client *c) {
 	case 'C':
 		return dc.h;
 	case 'N':
-		return textw(c->name);
+		return textw(c->cold->name);
 	case 'T':
 		w = 0;
 		for (j = 0; j < ntags; j++) {
@@ -164,9 +164,12 @@ void
 drawclient(Client *c) {
 	size_t i;
 
-	if (style.opacity) {
-		setopacity(c, c == sel ? OPAQUE : style.opacity);
-	}
+	/* unfocused clients get the opacity option applied on top of their
+	 * rule's */
+	if (c == sel || !style.opacity)
+		setopacity(c, c->cold->opacity);
+	else
+		setopacity(c, (double) c->cold->opacity * style.opacity / OPAQUE);
 	if (!isvisible(c, NULL))
 		return;
 	if (!c->title)
@@ -174,16 +177,16 @@ drawclient(Client *c) {
 	dc.x = dc.y = 0;
 	dc.w = c->w;
 	dc.h = style.titleheight;
-	XftDrawChange(c->xftdraw, c->drawable);
+	XftDrawChange(c->cold->xftdraw, c->cold->drawable);
 	XSetForeground(dpy, dc.gc, c == sel ? style.color.sel[ColBG] : style.color.norm[ColBG]);
 	XSetLineAttributes(dpy, dc.gc, style.border, LineSolid, CapNotLast, JoinMiter);
-	XFillRectangle(dpy, c->drawable, dc.gc, dc.x, dc.y, dc.w, dc.h);
-	if (dc.w < textw(c->name)) {
+	XFillRectangle(dpy, c->cold->drawable, dc.gc, dc.x, dc.y, dc.w, dc.h);
+	if (dc.w < textw(c->cold->name)) {
 		dc.w -= dc.h;
 		button[Close].x = dc.w;
-		drawtext(c->name, c->drawable, c->xftdraw,
+		drawtext(c->cold->name, c->cold->drawable, c->cold->xftdraw,
 		    c == sel ? style.color.sel : style.color.norm, dc.x, dc.y, dc.w);
-		drawbutton(c->drawable, button[Close],
+		drawbutton(c->cold->drawable, button[Close],
 		    c == sel ? style.color.sel : style.color.norm, dc.w,
 		    dc.h / 2 - button[Close].ph / 2);
 		goto end;
@@ -218,9 +221,37 @@ drawclient(Client *c) {
 	if (style.outline) {
 		XSetForeground(dpy, dc.gc,
 		    c == sel ? style.color.sel[ColBorder] : style.color.norm[ColBorder]);
-		XDrawLine(dpy, c->drawable, dc.gc, 0, dc.h - 1, dc.w, dc.h - 1);
+		XDrawLine(dpy, c->cold->drawable, dc.gc, 0, dc.h - 1, dc.w, dc.h - 1);
+	}
+	XCopyArea(dpy, c->cold->drawable, c->title, dc.gc, 0, 0, c->w, dc.h, 0, 0);
+}
+
+/* Draws the switcher window row by row through a title sized pixmap: the
+ * query first, then n clients with the cur-th one highlighted. */
+void
+drawswitcher(Window w, Pixmap pm, XftDraw *xd, unsigned int width,
+    const char *query, Client **list, int n, int cur) {
+	char buf[512];
+	unsigned long *col;
+	int i;
+
+	dc.x = dc.y = 0;
+	dc.w = width;
+	dc.h = style.titleheight;
+	for (i = -1; i < n; i++) {
+		col = (i == cur) ? style.color.sel : style.color.norm;
+		if (i < 0)
+			snprintf(buf, sizeof(buf), "> %s", query);
+		else if (list[i]->cold->class && *list[i]->cold->class)
+			snprintf(buf, sizeof(buf), "%s (%s)", list[i]->cold->name,
+			    list[i]->cold->class);
+		else
+			snprintf(buf, sizeof(buf), "%s", list[i]->cold->name);
+		XSetForeground(dpy, dc.gc, col[ColBG]);
+		XFillRectangle(dpy, pm, dc.gc, 0, 0, dc.w, dc.h);
+		drawtext(buf, pm, xd, col, 0, 0, dc.w - dc.font.height);
+		XCopyArea(dpy, pm, w, dc.gc, 0, 0, dc.w, dc.h, 0, (i + 1) * dc.h);
 	}
-	XCopyArea(dpy, c->drawable, c->title, dc.gc, 0, 0, c->w, dc.h, 0, 0);
 }
 
 static unsigned long
@@ -34,6 +34,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <strings.h>
+#include <time.h>
 #include <unistd.h>
 #include <regex.h>
 #include <signal.h>
@@ -62,42 +63,56 @@
 
 
 /* enums */
-enum { StrutsOn, StrutsOff, StrutsHide };		    /* struts position */
 enum { CurNormal, CurResize, CurMove, CurLast };	    /* cursor */
 enum { Clk2Focus, SloppyFloat, AllSloppy, SloppyRaise };    /* focus model */
 
 /* function declarations */
+int ipcfds(fd_set * rd, fd_set * wr, int maxfd);
+void ipchandle(fd_set * rd, fd_set * wr);
+void allocframe(Client * c, XWindowAttributes * wa);
 void applyatoms(Client * c);
 void applyrules(Client * c);
 void arrange(Monitor * m);
+void arrangetiled(Monitor * m);
 void attach(Client * c, Bool attachaside);
 void attachstack(Client * c);
 void ban(Client * c);
+void batchbegin(void);
+void batchend(void);
 void buttonpress(XEvent * e);
-void bstack(Monitor * m);
 void checkotherwm(void);
 void cleanup(void);
 void compileregs(void);
+void configclient(Client * c, XConfigureRequestEvent * ev);
 void configure(Client * c);
 void configurenotify(XEvent * e);
 void configurerequest(XEvent * e);
+void createtitle(Client * c);
 void destroynotify(XEvent * e);
 void detach(Client * c);
 void detachstack(Client * c);
+void dirtytiled(void);
 void *emallocz(unsigned int size);
 void enternotify(XEvent * e);
 void eprint(const char *errstr, ...);
+char *estrdup(const char *s);
 void expose(XEvent * e);
 void iconify(const char *arg);
+void ignoreenter(void);
 void incnmaster(const char *arg);
 void focus(Client * c);
 void focusnext(const char *arg);
 void focusprev(const char *arg);
+void freeframe(Client * c);
+void freetitle(Client * c);
+Colormap getcolormap(Visual * visual);
 Client *getclient(Window w, Client * list, int part);
 const char *getresource(const char *resource, const char *defval);
 long getstate(Window w);
 Bool gettextprop(Window w, Atom atom, char *text, unsigned int size);
 void getpointer(int *x, int *y);
+void grabbuttons(Client * c, Bool focused);
+void holdback(Client * c, int kind, unsigned long long due);
 Monitor *getmonitor(int x, int y);
 Monitor *curmonitor();
 Monitor *clientmonitor(Client * c);
@@ -110,30 +125,44 @@ void leavenotify(XEvent * e);
 void focusin(XEvent * e);
 void manage(Window w, XWindowAttributes * wa);
 void mappingnotify(XEvent * e);
-void monocle(Monitor * m);
 void maprequest(XEvent * e);
 void mousemove(Client * c);
+void mruadd(Client * c);
+void mrudrop(Client * c);
+void mrupush(Client * c);
 void mouseresize(Client * c);
+Bool moveresize(Client * c, int x, int y, int w, int h);
 void moveresizekb(const char *arg);
+Client *nextfocus(Monitor * m, Bool tiled);
 Client *nexttiled(Client * c, Monitor * m);
 Client *prevtiled(Client * c, Monitor * m);
+Client **tiledclients(Monitor * m);
+Client *toptiled(Monitor * m);
 void place(Client *c);
 void propertynotify(XEvent * e);
 void reparentnotify(XEvent * e);
 void quit(const char *arg);
+long long ratecatchup(void);
+Bool ratelimit(Client * c, int kind);
+int reaptitles(void);
+void retitle(Client * c);
+void putcolormap(Visual * visual);
 void restart(const char *arg);
 void resize(Client * c, int x, int y, int w, int h, Bool sizehints);
 void restack(Monitor * m);
+Bool *resizetags(Bool *t, unsigned int n);
 void run(void);
+long long runtimers(void);
 void save(Client * c);
 void scan(void);
 void setclientstate(Client * c, long state);
 void setlayout(const char *arg);
 void setmwfact(const char *arg);
+void settags(unsigned int n);
 void setup(char *);
 void spawn(const char *arg);
 void tag(const char *arg);
-void tile(Monitor * m);
+Bool titlelimit(Client * c);
 void togglestruts(const char *arg);
 void togglefloating(const char *arg);
 void togglemax(const char *arg);
@@ -143,6 +172,7 @@ void toggleview(const char *arg);
 void togglemonitor(const char *arg);
 void focusview(const char *arg);
 void unban(Client * c);
+void uncover(Client * c);
 void unmanage(Client * c);
 void updategeom(Monitor * m);
 void updatestruts(Monitor * m);
@@ -168,11 +198,17 @@ Window root;
 XrmDatabase xrdb;
 Bool otherwm;
 Bool running = True;
+volatile sig_atomic_t dumpstats = 0;
+int sigpipe[2] = { -1, -1 };	/* wakes run() up for dumpstats */
 Bool selscreen = True;
 Monitor *monitors;
 Client *clients;
 Client *sel;
 Client *stack;
+int batching;			/* see batchbegin() */
+int nuntitled;			/* hidden titles, see reaptitles() */
+unsigned long enterserial;	/* see ignoreenter() */
+int nratepending;		/* clients with throttled work, see ratecatchup() */
 Cursor cursor[CurLast];
 Style style;
 Button button[LastBtn];
@@ -188,25 +224,11 @@ unsigned int numlockmask;
 /* configuration, allows nested code to access above variables */
 #include "config.h"
 
-struct {
-	Bool attachaside;
-	Bool dectiled;
-	Bool hidebastards;
-	int focus;
-	int gap;
-	int snap;
-	char command[255];
-} options;
-
-Layout layouts[] = {
-	/* function	symbol	features */
-	{  NULL,	'i',	OVERLAP },
-	{  tile,	't',	MWFACT | NMASTER | ZOOM },
-	{  bstack,	'b',	MWFACT | ZOOM },
-	{  monocle,	'm',	0 },
-	{  NULL,	'f',	OVERLAP },
-	{  NULL,	'\0',	0 },
-};
+Options options;
+Frame frames[FRAMEPOOL];	/* see allocframe() */
+int nframes;
+Cmap *cmaps;			/* see getcolormap() */
+int ncmaps;
 
 void (*handler[LASTEvent]) (XEvent *) = {
 	[ButtonPress] = buttonpress,
@@ -231,6 +253,63 @@ void (*handler[LASTEvent]) (XEvent *) = {
 };
 
 /* function implementations */
+/* Frames of unmanaged clients, with their title if they had one, wait in
+ * frames[] for a client of the same depth and visual, so popups that come
+ * and go don't create and destroy a handful of server resources each
+ * time. */
+void
+allocframe(Client * c, XWindowAttributes * wa) {
+	XSetWindowAttributes twa;
+	unsigned long mask;
+	Frame *f;
+	int i;
+
+	c->cold->framedepth = wa->depth == 32 ? 32 : DefaultDepth(dpy, screen);
+	c->cold->framevisual = wa->depth == 32 ? wa->visual : DefaultVisual(dpy, screen);
+	for (i = nframes - 1; i >= 0; i--)
+		if (frames[i].depth == c->cold->framedepth
+		    && frames[i].visual == c->cold->framevisual)
+			break;
+	if (i < 0) {
+		twa.override_redirect = True;
+		twa.event_mask = FRAMEMASK;
+		mask = CWOverrideRedirect | CWEventMask;
+		if (wa->depth == 32) {
+			mask |= CWColormap | CWBorderPixel | CWBackPixel;
+			twa.colormap = getcolormap(wa->visual);
+			twa.background_pixel = BlackPixel(dpy, screen);
+			twa.border_pixel = BlackPixel(dpy, screen);
+		}
+		c->frame = XCreateWindow(dpy, root, c->x, c->y, c->w, c->h,
+		    c->border, c->cold->framedepth, InputOutput,
+		    c->cold->framevisual, mask, &twa);
+		return;
+	}
+	f = &frames[i];
+	c->frame = f->frame;
+	XMoveResizeWindow(dpy, c->frame, c->x, c->y, c->w, c->h);
+	XSelectInput(dpy, c->frame, FRAMEMASK);
+	if (f->title && c->hastitle) {
+		/* hidden until updateframe() wants it */
+		c->title = f->title;
+		c->cold->drawable = f->drawable;
+		c->cold->xftdraw = f->xftdraw;
+		c->cold->untitled = time(NULL);
+		nuntitled++;
+		if (f->tw != c->w) {
+			XResizeWindow(dpy, c->title, c->w, style.titleheight);
+			XFreePixmap(dpy, c->cold->drawable);
+			c->cold->drawable = XCreatePixmap(dpy, root, c->w,
+			    style.titleheight, DefaultDepth(dpy, screen));
+		}
+	} else if (f->title) {
+		XftDrawDestroy(f->xftdraw);
+		XFreePixmap(dpy, f->drawable);
+		XDestroyWindow(dpy, f->title);
+	}
+	frames[i] = frames[--nframes];
+}
+
 void
 applyatoms(Client * c) {
 	unsigned int *t;
@@ -258,12 +337,16 @@ applyrules(Client * c) {
 	/* rule matching */
 	XGetClassHint(dpy, c->win, &ch);
 	snprintf(buf, sizeof(buf), "%s:%s:%s",
-	    ch.res_class ? ch.res_class : "", ch.res_name ? ch.res_name : "", c->name);
+	    ch.res_class ? ch.res_class : "", ch.res_name ? ch.res_name : "", c->cold->name);
+	free(c->cold->class);
+	c->cold->class = estrdup(ch.res_class ? ch.res_class : "");
+	switcherindex(c);
 	buf[LENGTH(buf)-1] = 0;
 	for (i = 0; i < nrules; i++)
 		if (rules[i]->propregex && !regexec(rules[i]->propregex, buf, 1, &tmp, 0)) {
-			c->isfloating = rules[i]->isfloating;
-			c->title = rules[i]->hastitle;
+			c->isfloating = rules[i]->isfloating ? True : False;
+			c->hastitle = rules[i]->hastitle ? True : False;
+			c->cold->opacity = OPAQUE * rules[i]->opacity;
 			for (j = 0; rules[i]->tagregex && j < ntags; j++) {
 				if (!regexec(rules[i]->tagregex, tags[j], 1, &tmp, 0)) {
 					matched = True;
@@ -289,43 +372,81 @@ arrangefloats(Monitor * m) {
 		if (isvisible(c, m) && !c->isbastard &&
 			       	(c->isfloating || MFEATURES(m, OVERLAP))
 			       	&& !c->ismax && !c->isicon) {
-			DPRINTF("%d %d\n", c->rx, c->ry);
-			if (!(om = getmonitor(c->rx + c->rw/2,
-				       	c->ry + c->rh/2)))
+			DPRINTF("%d %d\n", c->cold->rx, c->cold->ry);
+			if (!(om = getmonitor(c->cold->rx + c->cold->rw/2,
+				       	c->cold->ry + c->cold->rh/2)))
 				continue;
-			dx = om->sx + om->sw - c->rx;
-			dy = om->sy + om->sh - c->ry;
+			dx = om->sx + om->sw - c->cold->rx;
+			dy = om->sy + om->sh - c->cold->ry;
 			if (dx > m->sw) 
 				dx = m->sw;
 			if (dy > m->sh) 
 				dy = m->sh;
-			resize(c, m->sx + m->sw - dx, m->sy + m->sh - dy, c->rw, c->rh, True);
+			resize(c, m->sx + m->sw - dx, m->sy + m->sh - dy, c->cold->rw, c->cold->rh, True);
 			save(c);
 		}
 	}
 }
 
+void
+arrangetiled(Monitor * m) {
+	static Geometry *g = NULL;
+	static int size = 0;
+	Client **cl;
+	int i, n;
+
+	cl = tiledclients(m);
+	if (!(n = m->ntiled))
+		return;
+	if (n > size) {
+		size = m->tiledsize;
+		if (!(g = realloc(g, size * sizeof(Geometry))))
+			eprint("fatal: could not realloc() %u bytes\n",
+			    (unsigned int)(size * sizeof(Geometry)));
+	}
+	/* pure pass */
+	views[m->curtag].layout->arrange(m, &views[m->curtag], cl, g, n);
+	/* commit pass: only clients whose geometry changed cause requests */
+	for (i = 0; i < n; i++) {
+		cl[i]->ismax = False;
+		moveresize(cl[i], g[i].x, g[i].y, g[i].w, g[i].h);
+	}
+}
+
 void
 arrangemon(Monitor * m) {
 	Client *c;
+	Client *top = NULL;
+	Monitor *cm;
+	int barpos = views[m->curtag].barpos;
+	Bool hiding = False, occlude;
 
 	if (views[m->curtag].layout->arrange)
-		views[m->curtag].layout->arrange(m);
+		arrangetiled(m);
 	arrangefloats(m);
 	restack(m);
+	if ((occlude = options.monoclehide && MFEATURES(m, OCCLUDE)))
+		top = toptiled(m);
+	/* Decides in one pass which clients of m change visibility.  Only
+	 * those cost requests, and the ones coming into view are mapped
+	 * before the others go away.  Tiled clients under the top one of an
+	 * occluding layout are hidden, see uncover(). */
 	for (c = stack; c; c = c->snext) {
-		if ((clientmonitor(c) == m) && ((!c->isbastard && !c->isicon) ||
-			(c->isbastard && views[m->curtag].barpos == StrutsOn))) {
+		c->hide = False;
+		if ((cm = clientmonitor(c)) && cm != m)
+			continue;
+		if (!cm || (c->isbastard ? barpos == StrutsHide : c->isicon)) {
+			c->hide = !c->isbanned;
+			hiding |= c->hide;
+		} else if (occlude && c != top && !c->isbastard && !c->isfloating) {
+			c->hide = !c->isbanned;
+			hiding |= c->hide;
+		} else if (!c->isbastard || barpos == StrutsOn)
 			unban(c);
-		}
 	}
-
-	for (c = stack; c; c = c->snext) {
-		if ((clientmonitor(c) == NULL) || (!c->isbastard && c->isicon) ||
-			(c->isbastard && views[m->curtag].barpos == StrutsHide)) {
+	for (c = stack; hiding && c; c = c->snext)
+		if (c->hide)
 			ban(c);
-		}
-	}
 }
 
 void
@@ -337,10 +458,13 @@ arrange(Monitor * m) {
 			arrangemon(i);
 	} else
 		arrangemon(m);
+	ignoreenter();
+	ipcnotify(IpcView | IpcLayout, NULL);
 }
 
 void
 attach(Client * c, Bool attachaside) {
+	dirtytiled();
 	if (attachaside) {
 		if (clients) {
 			Client * lastClient = clients;
@@ -370,7 +494,7 @@ void
 ban(Client * c) {
 	if (c->isbanned)
 		return;
-	c->ignoreunmap++;
+	c->cold->ignoreunmap++;
 	setclientstate(c, IconicState);
 	XSelectInput(dpy, c->win, CLIENTMASK & ~(StructureNotifyMask | EnterWindowMask));
 	XSelectInput(dpy, c->frame, NoEventMask);
@@ -381,6 +505,27 @@ ban(Client * c) {
 	c->isbanned = True;
 }
 
+/* Tag switches (view(), toggleview(), viewprevtag()) run between these,
+ * so everything up to the matching batchend() reaches the screen in one
+ * burst: nothing waits for a round trip and, with the atomicswitch
+ * option, the server is grabbed so it neither draws nor serves other
+ * clients halfway.  arrange() already maps the windows coming into view,
+ * at their new geometry, before unmapping the others.  Batches nest. */
+void
+batchbegin(void) {
+	if (batching++ == 0 && options.atomicswitch)
+		XGrabServer(dpy);
+}
+
+void
+batchend(void) {
+	if (--batching > 0)
+		return;
+	if (options.atomicswitch)
+		XUngrabServer(dpy);
+	ignoreenter();
+}
+
 void
 buttonpress(XEvent * e) {
 	Client *c;
@@ -406,7 +551,7 @@ buttonpress(XEvent * e) {
 		return;
 	}
 	if ((c = getclient(ev->window, clients, ClientTitle))) {
-		DPRINTF("TITLE %s: 0x%x\n", c->name, (int) ev->window);
+		DPRINTF("TITLE %s: 0x%x\n", c->cold->name, (int) ev->window);
 		focus(c);
 		for (i = 0; i < LastBtn; i++) {
 			if (button[i].action == NULL)
@@ -437,7 +582,7 @@ buttonpress(XEvent * e) {
 		else if (ev->button == Button3)
 			mouseresize(c);
 	} else if ((c = getclient(ev->window, clients, ClientWindow))) {
-		DPRINTF("WINDOW %s: 0x%x\n", c->name, (int) ev->window);
+		DPRINTF("WINDOW %s: 0x%x\n", c->cold->name, (int) ev->window);
 		focus(c);
 		restack(curmonitor());
 		if (CLEANMASK(ev->state) != modkey) {
@@ -463,7 +608,7 @@ buttonpress(XEvent * e) {
 			mouseresize(c);
 		}
 	} else if ((c = getclient(ev->window, clients, ClientFrame))) {
-		DPRINTF("FRAME %s: 0x%x\n", c->name, (int) ev->window);
+		DPRINTF("FRAME %s: 0x%x\n", c->cold->name, (int) ev->window);
 		/* Not supposed to happen */
 	}
 }
@@ -502,6 +647,9 @@ cleanup(void) {
 	XFreeCursor(dpy, cursor[CurMove]);
 	XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
 	XSync(dpy, False);
+	traceclose();
+	ipcclose();
+	snapshotclose();
 }
 
 void
@@ -549,51 +697,82 @@ configurenotify(XEvent * e) {
 	}
 }
 
+/* Carries out ev, a ConfigureRequest of c. */
+void
+configclient(Client * c, XConfigureRequestEvent * ev) {
+	int x = c->x, y = c->y, w = c->w, h = c->h;
+
+	if (ev->value_mask & CWBorderWidth)
+		c->border = ev->border_width;
+	if (c->isfixed || c->isfloating || MFEATURES(clientmonitor(c), OVERLAP)) {
+		if (ev->value_mask & CWX)
+			x = ev->x;
+		if (ev->value_mask & CWY)
+			y = ev->y;
+		if (ev->value_mask & CWWidth)
+			w = ev->width;
+		if (ev->value_mask & CWHeight)
+			h = ev->height + c->th;
+		if (!(ev->value_mask & (CWX | CWY)) /* resize request */
+		    && (ev->value_mask & (CWWidth | CWHeight))) {
+			DPRINTF("RESIZE %s (%d,%d)->(%d,%d)\n", c->cold->name, c->w, c->h, w, h);
+			resize(c, c->x, c->y, w, h, True);
+			save(c);
+		} else if ((ev->value_mask & (CWX | CWY)) /* move request */
+		    && !(ev->value_mask & (CWWidth | CWHeight))) {
+			DPRINTF("MOVE %s (%d,%d)->(%d,%d)\n", c->cold->name, c->x, c->y, x, y);
+			resize(c, x, y, c->w, c->h, True);
+			save(c);
+		} else if ((ev->value_mask & (CWX | CWY)) /* move and resize request */
+		    && (ev->value_mask & (CWWidth | CWHeight))) {
+			DPRINTF("MOVE&RESIZE(MOVE) %s (%d,%d)->(%d,%d)\n", c->cold->name, c->x, c->y, ev->x, ev->y);
+			DPRINTF("MOVE&RESIZE(RESIZE) %s (%d,%d)->(%d,%d)\n", c->cold->name, c->w, c->h, ev->width, ev->height);
+			resize(c, x, y, w, h, True);
+			save(c);
+		} else if ((ev->value_mask & CWStackMode)) {
+			DPRINTF("RESTACK %s ignoring\n", c->cold->name);
+			configure(c);
+		}
+	} else {
+		configure(c);
+	}
+}
+
 void
 configurerequest(XEvent * e) {
 	Client *c;
 	XConfigureRequestEvent *ev = &e->xconfigurerequest;
+	XConfigureRequestEvent *p;
 	XWindowChanges wc;
-	Monitor *cm;
-	int x, y, w, h;
 
 	if ((c = getclient(ev->window, clients, ClientWindow))) {
-		cm = clientmonitor(c);
+		/* merge with what is held back, keeping the latest value of
+		 * every field asked for */
+		p = &c->cold->pendingcr;
+		if (!(c->cold->ratepending & BIT(RateConfigure)))
+			p->value_mask = 0;
+		if (ev->value_mask & CWX)
+			p->x = ev->x;
+		if (ev->value_mask & CWY)
+			p->y = ev->y;
+		if (ev->value_mask & CWWidth)
+			p->width = ev->width;
+		if (ev->value_mask & CWHeight)
+			p->height = ev->height;
 		if (ev->value_mask & CWBorderWidth)
-			c->border = ev->border_width;
-		if (c->isfixed || c->isfloating || MFEATURES(clientmonitor(c), OVERLAP)) {
-			if (ev->value_mask & CWX)
-				x = ev->x;
-			if (ev->value_mask & CWY)
-				y = ev->y;
-			if (ev->value_mask & CWWidth)
-				w = ev->width;
-			if (ev->value_mask & CWHeight)
-				h = ev->height + c->th;
-			cm = getmonitor(x, y);
-			if (!(ev->value_mask & (CWX | CWY)) /* resize request */
-			    && (ev->value_mask & (CWWidth | CWHeight))) {
-				DPRINTF("RESIZE %s (%d,%d)->(%d,%d)\n", c->name, c->w, c->h, w, h);
-				resize(c, c->x, c->y, w, h, True);
-				save(c);
-			} else if ((ev->value_mask & (CWX | CWY)) /* move request */
-			    && !(ev->value_mask & (CWWidth | CWHeight))) {
-				DPRINTF("MOVE %s (%d,%d)->(%d,%d)\n", c->name, c->x, c->y, x, y);
-				resize(c, x, y, c->w, c->h, True);
-				save(c);
-			} else if ((ev->value_mask & (CWX | CWY)) /* move and resize request */
-			    && (ev->value_mask & (CWWidth | CWHeight))) {
-				DPRINTF("MOVE&RESIZE(MOVE) %s (%d,%d)->(%d,%d)\n", c->name, c->x, c->y, ev->x, ev->y);
-				DPRINTF("MOVE&RESIZE(RESIZE) %s (%d,%d)->(%d,%d)\n", c->name, c->w, c->h, ev->width, ev->height);
-				resize(c, x, y, w, h, True);
-				save(c);
-			} else if ((ev->value_mask & CWStackMode)) {
-				DPRINTF("RESTACK %s ignoring\n", c->name);
-				configure(c);
-			}
-		} else {
+			p->border_width = ev->border_width;
+		p->value_mask |= ev->value_mask;
+		if (!ratelimit(c, RateConfigure)) {
+			/* tell the client nothing changed for now */
 			configure(c);
+			return;
+		}
+		if (c->cold->ratepending & BIT(RateConfigure)) {
+			c->cold->ratepending &= ~BIT(RateConfigure);
+			if (!c->cold->ratepending)
+				nratepending--;
 		}
+		configclient(c, p);
 	} else {
 		wc.x = ev->x;
 		wc.y = ev->y;
@@ -607,6 +786,25 @@ configurerequest(XEvent * e) {
 	XSync(dpy, False);
 }
 
+/* Titles, their pixmap and XftDraw are only made once updateframe() has
+ * to show them.  With decoratetiled off most clients never need one. */
+void
+createtitle(Client * c) {
+	XSetWindowAttributes twa;
+
+	twa.event_mask = ExposureMask | MOUSEMASK;
+	/* we create title as root's child as a workaround for 32bit visuals */
+	c->title = XCreateWindow(dpy, root, 0, 0, c->w, style.titleheight,
+	    0, DefaultDepth(dpy, screen), CopyFromParent,
+	    DefaultVisual(dpy, screen), CWEventMask, &twa);
+	c->cold->drawable = XCreatePixmap(dpy, root, c->w, style.titleheight,
+	    DefaultDepth(dpy, screen));
+	c->cold->xftdraw = XftDrawCreate(dpy, c->cold->drawable,
+	    DefaultVisual(dpy, screen), DefaultColormap(dpy, screen));
+	XReparentWindow(dpy, c->title, c->frame, 0, 0);
+	tracemanage(c);
+}
+
 void
 destroynotify(XEvent * e) {
 	Client *c;
@@ -620,6 +818,7 @@ destroynotify(XEvent * e) {
 
 void
 detach(Client * c) {
+	dirtytiled();
 	if (c->prev)
 		c->prev->next = c->next;
 	if (c->next)
@@ -637,6 +836,17 @@ detachstack(Client * c) {
 	*tc = c->snext;
 }
 
+/* Invalidates the tiled client list of every monitor.  Needs to be called
+ * whenever the client list, a client's tags, floating or icon state or the
+ * viewed tags of a monitor change. */
+void
+dirtytiled(void) {
+	Monitor *m;
+
+	for (m = monitors; m; m = m->next)
+		m->tiledok = False;
+}
+
 void *
 emallocz(unsigned int size) {
 	void *res = calloc(1, size);
@@ -653,6 +863,8 @@ enternotify(XEvent * e) {
 
 	if (ev->mode != NotifyNormal || ev->detail == NotifyInferior)
 		return;
+	if (ev->serial < enterserial)
+		return;		/* the pointer didn't move, windows did */
 	if (!curmonitor())
 		return;
 	if ((c = getclient(ev->window, clients, ClientFrame))) {
@@ -692,6 +904,13 @@ eprint(const char *errstr, ...) {
 	exit(EXIT_FAILURE);
 }
 
+char *
+estrdup(const char *s) {
+	size_t len = strlen(s) + 1;
+
+	return memcpy(emallocz(len), s, len);
+}
+
 void
 focusin(XEvent * e) {
 	XFocusChangeEvent *ev = &e->xfocus;
@@ -738,16 +957,21 @@ focus(Client * c) {
 
 	o = sel;
 	if ((!c && selscreen) || (c && (c->isbastard || !isvisible(c, curmonitor()))))
-		for (c = stack;
-		    c && (c->isbastard || c->isicon || !isvisible(c, curmonitor())); c = c->snext);
+		c = nextfocus(curmonitor(), False);
 	if (sel && sel != c) {
 		XSetWindowBorder(dpy, sel->frame, style.color.norm[ColBorder]);
 	}
 	if (c) {
 		detachstack(c);
 		attachstack(c);
-		/* unban(c); */
-	}
+		mrupush(c);
+		if (c->isbanned && options.monoclehide)
+			uncover(c);
+	}
+	if (o && o != c)
+		grabbuttons(o, False);
+	if (c && c != o)
+		grabbuttons(c, True);
 	sel = c;
 	if (!selscreen)
 		return;
@@ -767,6 +991,7 @@ focus(Client * c) {
 	updateatom[ActiveWindow] (sel);
 	updateatom[ClientList] (NULL);
 	updateatom[CurDesk] (NULL);
+	ipcnotify(IpcFocus, NULL);
 }
 
 void
@@ -777,6 +1002,7 @@ focusicon(const char *arg) {
 	if (!c)
 		return;
 	c->isicon = False;
+	dirtytiled();
 	focus(c);
 	arrange(curmonitor());
 }
@@ -825,12 +1051,25 @@ iconify(const char *arg) {
 	if (!sel)
 		return;
 	c = sel;
-	focusnext(NULL);
 	ban(c);
 	c->isicon = True;
+	dirtytiled();
+	focus(NULL);
 	arrange(curmonitor());
 }
 
+/* Windows moving under the pointer cause EnterNotify events that would
+ * make sloppy focus jump around.  Those carry the serial of the request
+ * that caused them, so enternotify() drops everything older than the
+ * XNoOp() sent here.  Events of the pointer actually moving afterwards get
+ * its serial or a later one.  No round trip is needed, and crossings that
+ * happen later are not lost. */
+void
+ignoreenter(void) {
+	enterserial = NextRequest(dpy);
+	XNoOp(dpy);
+}
+
 void
 incnmaster(const char *arg) {
 	unsigned int i;
@@ -850,6 +1089,81 @@ incnmaster(const char *arg) {
 		arrange(curmonitor());
 }
 
+/* Keeps the frame of c for allocframe(), or destroys it when frames[] is
+ * full.  c's window must be out of it already, and the events caused by
+ * taking it out already queued. */
+void
+freeframe(Client * c) {
+	XEvent ev;
+	Frame *f;
+
+	if (nframes == FRAMEPOOL) {
+		freetitle(c);
+		XDestroyWindow(dpy, c->frame);
+		if (c->cold->framedepth == 32)
+			putcolormap(c->cold->framevisual);
+		return;
+	}
+	if (c->cold->shownopacity != OPAQUE)
+		XDeleteProperty(dpy, c->frame, atom[WindowOpacity]);
+	/* what is still queued for the frame and title is about c; the
+	 * next client to get them must not see it */
+	while (XCheckWindowEvent(dpy, c->frame, FRAMEMASK | ExposureMask, &ev));
+	if (c->title)
+		while (XCheckWindowEvent(dpy, c->title, ExposureMask | MOUSEMASK, &ev));
+	f = &frames[nframes++];
+	f->frame = c->frame;
+	f->depth = c->cold->framedepth;
+	f->visual = c->cold->framevisual;
+	f->title = c->title;
+	f->drawable = c->cold->drawable;
+	f->xftdraw = c->cold->xftdraw;
+	f->tw = c->w;
+	if (!c->title)
+		return;
+	if (c->cold->untitled)
+		nuntitled--;
+	else
+		XUnmapWindow(dpy, c->title);
+	c->title = None;
+	c->cold->untitled = 0;
+}
+
+void
+freetitle(Client * c) {
+	if (!c->title)
+		return;
+	XftDrawDestroy(c->cold->xftdraw);
+	XFreePixmap(dpy, c->cold->drawable);
+	XDestroyWindow(dpy, c->title);
+	c->title = None;
+	c->cold->xftdraw = NULL;
+	c->cold->drawable = None;
+	if (c->cold->untitled) {
+		c->cold->untitled = 0;
+		nuntitled--;
+	}
+}
+
+/* Frames of 32 bit clients need a colormap for the client's visual.  One
+ * per visual is shared by all of them and freed with the last one. */
+Colormap
+getcolormap(Visual * visual) {
+	int i;
+
+	for (i = 0; i < ncmaps && cmaps[i].visual != visual; i++);
+	if (i == ncmaps) {
+		if (!(cmaps = realloc(cmaps, ++ncmaps * sizeof(Cmap))))
+			eprint("fatal: could not realloc() %u bytes\n",
+			    (unsigned int)(ncmaps * sizeof(Cmap)));
+		cmaps[i].visual = visual;
+		cmaps[i].colormap = XCreateColormap(dpy, root, visual, AllocNone);
+		cmaps[i].refs = 0;
+	}
+	cmaps[i].refs++;
+	return cmaps[i].colormap;
+}
+
 Client *
 getclient(Window w, Client * list, int part) {
 	Client *c;
@@ -919,6 +1233,11 @@ int
 idxoftag(const char *tag) {
 	unsigned int i;
 
+	/* keypress() passes tags[i] itself, which finds the right tag even
+	 * if two share a name */
+	for (i = 0; i < ntags && tag != tags[i]; i++);
+	if (i < ntags)
+		return i;
 	for (i = 0; (i < ntags) && strcmp(tag, tags[i]); i++);
 	return (i < ntags) ? i : 0;
 }
@@ -943,6 +1262,28 @@ isvisible(Client * c, Monitor * m) {
 	return False;
 }
 
+/* Unfocused clients have all buttons grabbed, so that buttonpress() can
+ * focus and raise them before replaying the click.  The focused client
+ * keeps only the modkey grabs for moving and resizing, and its clicks go
+ * straight to the application without a round trip through us.  Sloppy
+ * focus that doesn't raise relies on the click to raise, so there the
+ * focused client keeps everything. */
+void
+grabbuttons(Client * c, Bool focused) {
+	unsigned int mods[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
+	unsigned int i;
+
+	XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+	if (!focused || (options.focus != Clk2Focus && options.focus != SloppyRaise)) {
+		XGrabButton(dpy, AnyButton, AnyModifier, c->win, True,
+		    ButtonPressMask, GrabModeSync, GrabModeAsync, None, None);
+		return;
+	}
+	for (i = 0; i < LENGTH(mods); i++)
+		XGrabButton(dpy, AnyButton, modkey | mods[i], c->win, True,
+		    ButtonPressMask, GrabModeAsync, GrabModeAsync, None, None);
+}
+
 void
 grabkeys(void) {
 	unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
@@ -963,6 +1304,7 @@ keypress(XEvent * e) {
 	unsigned int i;
 	KeySym keysym;
 	XKeyEvent *ev;
+	StatsMark sm;
 
 	if (!curmonitor())
 		return;
@@ -971,8 +1313,13 @@ keypress(XEvent * e) {
 	for (i = 0; i < nkeys; i++)
 		if (keysym == keys[i]->keysym
 		    && CLEANMASK(keys[i]->mod) == CLEANMASK(ev->state)) {
+			if (keys[i]->tag >= (int) ntags)
+				continue;	/* tag doesn't exist (yet) */
+			statsbegin(&sm);
 			if (keys[i]->func)
-				keys[i]->func(keys[i]->arg);
+				keys[i]->func(keys[i]->tag < 0 ? keys[i]->arg :
+				    tags[keys[i]->tag]);
+			statsaction(keys[i]->name, &sm);
 			XUngrabKeyboard(dpy, CurrentTime);
 		}
 }
@@ -1014,9 +1361,8 @@ manage(Window w, XWindowAttributes * wa) {
 	XWindowChanges wc;
 	XSetWindowAttributes twa;
 	XWMHints *wmh;
-	unsigned long mask = 0;
 
-	c = emallocz(sizeof(Client));
+	c = allocclient();
 	c->win = w;
 	if (checkatom(c->win, atom[WindowType], atom[WindowTypeDesk]) ||
 	    checkatom(c->win, atom[WindowType], atom[WindowTypeDock])) {
@@ -1031,13 +1377,12 @@ manage(Window w, XWindowAttributes * wa) {
 
 	cm = curmonitor();
 	c->isicon = False;
-	c->title = c->isbastard ? (Window) NULL : 1;
-	c->tags = emallocz(ntags * sizeof(cm->seltags[0]));
+	c->hastitle = !c->isbastard;
 	c->isfocusable = c->isbastard ? False : True;
 	c->border = c->isbastard ? 0 : style.border;
-	c->oldborder = c->isbastard ? 0 : wa->border_width; /* XXX: why? */
+	c->cold->oldborder = c->isbastard ? 0 : wa->border_width; /* XXX: why? */
 	/*  XReparentWindow() unmaps *mapped* windows */
-	c->ignoreunmap = wa->map_state == IsViewable ? 1 : 0;
+	c->cold->ignoreunmap = wa->map_state == IsViewable ? 1 : 0;
 	mwm_process_atom(c);
 	updatesizehints(c);
 
@@ -1052,7 +1397,7 @@ manage(Window w, XWindowAttributes * wa) {
 		}
 	}
 
-	c->th = c->title ? style.titleheight : 0;
+	c->th = c->hastitle ? style.titleheight : 0;
 
 	if (!c->isfloating)
 		c->isfloating = c->isfixed;
@@ -1062,10 +1407,10 @@ manage(Window w, XWindowAttributes * wa) {
 		XFree(wmh);
 	}
 
-	c->x = c->rx = wa->x;
-	c->y = c->ry = wa->y;
-	c->w = c->rw = wa->width;
-	c->h = c->rh = wa->height + c->th;
+	c->x = c->cold->rx = wa->x;
+	c->y = c->cold->ry = wa->y;
+	c->w = c->cold->rw = wa->width;
+	c->h = c->cold->rh = wa->height + c->th;
 
 	if (!wa->x && !wa->y && !c->isbastard)
 		place(c);
@@ -1078,7 +1423,8 @@ manage(Window w, XWindowAttributes * wa) {
 	}
 	c->hasstruts = getstruts(c); 
 	if (c->isbastard) {
-		free(c->tags);
+		if (c->tags != SLOTTAGS(c))
+			free(c->tags);
 		c->tags = cm->seltags;
 	}
 #if 0
@@ -1097,44 +1443,15 @@ manage(Window w, XWindowAttributes * wa) {
 	}
 #endif
 
-	XGrabButton(dpy, AnyButton, AnyModifier, c->win, True,
-			ButtonPressMask, GrabModeSync, GrabModeAsync, None, None);
-	twa.override_redirect = True;
-	twa.event_mask = FRAMEMASK;
-	mask = CWOverrideRedirect | CWEventMask;
-	if (wa->depth == 32) {
-		mask |= CWColormap | CWBorderPixel | CWBackPixel;
-		twa.colormap = XCreateColormap(dpy, root, wa->visual, AllocNone);
-		twa.background_pixel = BlackPixel(dpy, screen);
-		twa.border_pixel = BlackPixel(dpy, screen);
-	}
-	c->frame =
-	    XCreateWindow(dpy, root, c->x, c->y, c->w,
-	    c->h, c->border, wa->depth == 32 ? 32 : DefaultDepth(dpy, screen),
-	    InputOutput, wa->depth == 32 ? wa->visual : DefaultVisual(dpy,
-		screen), mask, &twa);
-
+	grabbuttons(c, False);
+	allocframe(c, wa);
 	wc.border_width = c->border;
 	XConfigureWindow(dpy, c->frame, CWBorderWidth, &wc);
 	XSetWindowBorder(dpy, c->frame, style.color.norm[ColBorder]);
 
-	twa.event_mask = ExposureMask | MOUSEMASK;
-	/* we create title as root's child as a workaround for 32bit visuals */
-	if (c->title) {
-		c->title = XCreateWindow(dpy, root, 0, 0, c->w, c->th,
-		    0, DefaultDepth(dpy, screen), CopyFromParent,
-		    DefaultVisual(dpy, screen), CWEventMask, &twa);
-		c->drawable =
-		    XCreatePixmap(dpy, root, c->w, c->th, DefaultDepth(dpy, screen));
-		c->xftdraw =
-		    XftDrawCreate(dpy, c->drawable, DefaultVisual(dpy, screen),
-		    DefaultColormap(dpy, screen));
-	} else {
-		c->title = (Window) NULL;
-	}
-
 	attach(c, options.attachaside);
 	attachstack(c);
+	mrupush(c);
 
 	twa.event_mask = CLIENTMASK;
 	twa.do_not_propagate_mask = CLIENTNOPROPAGATEMASK;
@@ -1142,7 +1459,6 @@ manage(Window w, XWindowAttributes * wa) {
 	XSelectInput(dpy, c->win, CLIENTMASK);
 
 	XReparentWindow(dpy, c->win, c->frame, 0, c->th);
-	XReparentWindow(dpy, c->title, c->frame, 0, 0);
 	XAddToSaveSet(dpy, c->win);
 	XMapWindow(dpy, c->win);
 	wc.border_width = 0;
@@ -1154,6 +1470,8 @@ manage(Window w, XWindowAttributes * wa) {
 	updateatom[ClientList] (NULL);
 	updateatom[WindowDesk] (c);
 	updateframe(c);
+	tracemanage(c);
+	ipcnotify(IpcClients, NULL);
 	if (!cm)
 		return;
 	if (c->hasstruts)
@@ -1186,21 +1504,6 @@ maprequest(XEvent * e) {
 		manage(ev->window, &wa);
 }
 
-void
-monocle(Monitor * m) {
-	Client *c;
-
-	for (c = nexttiled(clients, m); c; c = nexttiled(c->next, m)) {
-			if (views[m->curtag].barpos != StrutsOn)
-				resize(c, m->wax - c->border,
-						m->way - c->border, m->waw, m->wah, False);
-			else
-				resize(c, m->wax, m->way,
-						m->waw - 2 * c->border,
-						m->wah - 2 * c->border, False);
-	}
-}
-
 void
 moveresizekb(const char *arg) {
 	int dw, dh, dx, dy;
@@ -1211,10 +1514,10 @@ moveresizekb(const char *arg) {
 	if (!sel->isfloating)
 		return;
 	sscanf(arg, "%d %d %d %d", &dx, &dy, &dw, &dh);
-	if (dw && (dw < sel->incw))
-		dw = (dw / abs(dw)) * sel->incw;
-	if (dh && (dh < sel->inch))
-		dh = (dh / abs(dh)) * sel->inch;
+	if (dw && (dw < sel->cold->incw))
+		dw = (dw / abs(dw)) * sel->cold->incw;
+	if (dh && (dh < sel->cold->inch))
+		dh = (dh / abs(dh)) * sel->cold->inch;
 	resize(sel, sel->x + dx, sel->y + dy, sel->w + dw,
 	    sel->h + dh, True);
 }
@@ -1307,6 +1610,8 @@ mousemove(Client * c) {
 			if (m != nm) {
 				for (i = 0; i < ntags; i++)
 					c->tags[i] = nm->seltags[i];
+				mruadd(c);
+				dirtytiled();
 				updateatom[WindowDesk] (c);
 				drawclient(c);
 				arrange(NULL);
@@ -1317,6 +1622,66 @@ mousemove(Client * c) {
 	}
 }
 
+/* Puts c into the history of each of its tags where its focusseq says,
+ * which is the front when called by mrupush().  Every tag change calls
+ * it, so each history holds every client of its tag.  Clients taken off
+ * a tag stay in its history until they are unmanaged; readers check the
+ * tag again. */
+void
+mruadd(Client * c) {
+	View *v;
+	unsigned int i;
+	int j;
+
+	if (c->isbastard)
+		return;
+	for (i = 0; i < ntags; i++) {
+		if (!c->tags[i])
+			continue;
+		v = &views[i];
+		for (j = 0; j < v->nmru && v->mru[j] != c; j++);
+		if (j < v->nmru)
+			memmove(&v->mru[j], &v->mru[j + 1], (--v->nmru - j) * sizeof(Client *));
+		else if (v->nmru == v->mrusize) {
+			v->mrusize = v->mrusize ? v->mrusize * 2 : 16;
+			if (!(v->mru = realloc(v->mru, v->mrusize * sizeof(Client *))))
+				eprint("fatal: could not realloc() %u bytes\n",
+				    (unsigned int) (v->mrusize * sizeof(Client *)));
+		}
+		for (j = 0; j < v->nmru
+		    && v->mru[j]->focusseq > c->focusseq; j++);
+		memmove(&v->mru[j + 1], &v->mru[j], (v->nmru - j) * sizeof(Client *));
+		v->mru[j] = c;
+		v->nmru++;
+	}
+}
+
+/* Drops c from the focus history of every tag. */
+void
+mrudrop(Client * c) {
+	View *v;
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < ntags; i++) {
+		v = &views[i];
+		for (j = 0; j < v->nmru && v->mru[j] != c; j++);
+		if (j == v->nmru)
+			continue;
+		memmove(&v->mru[j], &v->mru[j + 1], (--v->nmru - j) * sizeof(Client *));
+	}
+}
+
+/* Makes c the most recently focused client of each of its tags.  manage()
+ * calls it too, so new clients come first like in the focus stack. */
+void
+mrupush(Client * c) {
+	static unsigned long seq;
+
+	c->focusseq = ++seq;
+	mruadd(c);
+}
+
 void
 mouseresize(Client * c) {
 	int ocx, ocy, nw, nh;
@@ -1342,7 +1707,7 @@ mouseresize(Client * c) {
 			XWarpPointer(dpy, None, c->win, 0, 0, 0, 0,
 			    c->w + c->border - 1, c->h + c->border - 1);
 			XUngrabPointer(dpy, CurrentTime);
-			while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+			ignoreenter();
 			return;
 		case ConfigureRequest:
 		case Expose:
@@ -1362,6 +1727,34 @@ mouseresize(Client * c) {
 	}
 }
 
+/* The client focus(NULL) picks on m: of the tags m shows, the client
+ * focused (or managed) last, only looking at tiled ones if tiled is set.
+ * That is usually first in its tag's history, so this looks at one
+ * client per viewed tag. */
+Client *
+nextfocus(Monitor * m, Bool tiled) {
+	Client *c, *best = NULL;
+	View *v;
+	unsigned int t;
+	int i;
+
+	if (!m)
+		return NULL;
+	for (t = 0; t < ntags; t++) {
+		if (!m->seltags[t])
+			continue;
+		v = &views[t];
+		for (i = 0; i < v->nmru; i++) {
+			c = v->mru[i];
+			if (c->tags[t] && !c->isicon && !(tiled && c->isfloating))
+				break;
+		}
+		if (i < v->nmru && (!best || c->focusseq > best->focusseq))
+			best = c;
+	}
+	return best;
+}
+
 Client *
 nexttiled(Client * c, Monitor * m) {
 	for (; c && (c->isfloating || !isvisible(c, m) || c->isbastard
@@ -1376,6 +1769,29 @@ prevtiled(Client * c, Monitor * m) {
 	return c;
 }
 
+/* Returns the visible tiled clients of m in client list order, m->ntiled
+ * of them.  The array is only rebuilt after dirtytiled(). */
+Client **
+tiledclients(Monitor * m) {
+	Client *c;
+
+	if (m->tiledok)
+		return m->tiled;
+	for (m->ntiled = 0, c = nexttiled(clients, m); c;
+	    c = nexttiled(c->next, m)) {
+		if (m->ntiled == m->tiledsize) {
+			m->tiledsize = m->tiledsize ? m->tiledsize * 2 : 32;
+			if (!(m->tiled = realloc(m->tiled,
+			    m->tiledsize * sizeof(Client *))))
+				eprint("fatal: could not realloc() %u bytes\n",
+				    (unsigned int)(m->tiledsize * sizeof(Client *)));
+		}
+		m->tiled[m->ntiled++] = c;
+	}
+	m->tiledok = True;
+	return m->tiled;
+}
+
 void
 reparentnotify(XEvent * e) {
 	Client *c;
@@ -1411,8 +1827,8 @@ place(Client *c) {
 		y = m->way + m->wah - c->h - rand()%d;
 	DPRINTF("%d %d\n", x, y);
 
-	c->rx = c->x = x;
-	c->ry = c->y = y;
+	c->cold->rx = c->x = x;
+	c->cold->ry = c->y = y;
 }
 
 void
@@ -1421,6 +1837,11 @@ propertynotify(XEvent * e) {
 	Window trans;
 	XPropertyEvent *ev = &e->xproperty;
 
+	if (ev->window == root) {
+		if (ev->atom == atom[DeskNames] && ev->state == PropertyNewValue)
+			ewmh_process_desktop_names();
+		return;
+	}
 	if ((c = getclient(ev->window, clients, ClientWindow))) {
 		if (ev->atom == atom[StrutPartial]) {
 			c->hasstruts = getstruts(c);
@@ -1429,29 +1850,40 @@ propertynotify(XEvent * e) {
 		}
 		if (ev->state == PropertyDelete) 
 			return;
-		if (ev->atom == atom[WindowName]) {
-			updatetitle(c);
-			drawclient(c);
+		if (ev->atom == atom[WindowName] || ev->atom == XA_WM_NAME) {
+			if (ratelimit(c, RateTitle) && titlelimit(c))
+				retitle(c);
+			return;
 		}
 		switch (ev->atom) {
 		case XA_WM_TRANSIENT_FOR:
 			XGetTransientForHint(dpy, c->win, &trans);
 			if (!c->isfloating
 			    && (c->isfloating =
-				(getclient(trans, clients, ClientWindow) != NULL)))
+				(getclient(trans, clients, ClientWindow) != NULL))) {
+				dirtytiled();
 				arrange(clientmonitor(c));
+			}
 			break;
 		case XA_WM_NORMAL_HINTS:
-			updatesizehints(c);
-			break;
-		case XA_WM_NAME:
-			updatetitle(c);
-			drawclient(c);
+			if (ratelimit(c, RateHints))
+				updatesizehints(c);
 			break;
 		}
 	}
 }
 
+void
+putcolormap(Visual * visual) {
+	int i;
+
+	for (i = 0; i < ncmaps && cmaps[i].visual != visual; i++);
+	if (i == ncmaps || --cmaps[i].refs > 0)
+		return;
+	XFreeColormap(dpy, cmaps[i].colormap);
+	cmaps[i] = cmaps[--ncmaps];
+}
+
 void
 quit(const char *arg) {
 	running = False;
@@ -1475,48 +1907,58 @@ resize(Client * c, int x, int y, int w, int h, Bool sizehints) {
 			h = 1;
 
 		/* temporarily remove base dimensions */
-		w -= c->basew;
-		h -= c->baseh;
+		w -= c->cold->basew;
+		h -= c->cold->baseh;
 
 		/* adjust for aspect limits */
-		if (c->minay > 0 && c->maxay > 0 && c->minax > 0 && c->maxax > 0) {
-			if (w * c->maxay > h * c->maxax)
-				w = h * c->maxax / c->maxay;
-			else if (w * c->minay < h * c->minax)
-				h = w * c->minay / c->minax;
+		if (c->cold->minay > 0 && c->cold->maxay > 0 && c->cold->minax > 0 && c->cold->maxax > 0) {
+			if (w * c->cold->maxay > h * c->cold->maxax)
+				w = h * c->cold->maxax / c->cold->maxay;
+			else if (w * c->cold->minay < h * c->cold->minax)
+				h = w * c->cold->minay / c->cold->minax;
 		}
 
 		/* adjust for increment value */
-		if (c->incw)
-			w -= w % c->incw;
-		if (c->inch)
-			h -= h % c->inch;
+		if (c->cold->incw)
+			w -= w % c->cold->incw;
+		if (c->cold->inch)
+			h -= h % c->cold->inch;
 
 		/* restore base dimensions */
-		w += c->basew;
-		h += c->baseh;
-
-		if (c->minw > 0 && w < c->minw)
-			w = c->minw;
-		if (c->minh > 0 && h - c->th < c->minh)
-			h = c->minh + c->th;
-		if (c->maxw > 0 && w > c->maxw)
-			w = c->maxw;
-		if (c->maxh > 0 && h - c->th > c->maxh)
-			h = c->maxh + c->th;
+		w += c->cold->basew;
+		h += c->cold->baseh;
+
+		if (c->cold->minw > 0 && w < c->cold->minw)
+			w = c->cold->minw;
+		if (c->cold->minh > 0 && h - c->th < c->cold->minh)
+			h = c->cold->minh + c->th;
+		if (c->cold->maxw > 0 && w > c->cold->maxw)
+			w = c->cold->maxw;
+		if (c->cold->maxh > 0 && h - c->th > c->cold->maxh)
+			h = c->cold->maxh + c->th;
 		h += c->th;
 	}
+	if (moveresize(c, x, y, w, h) && !batching)
+		XSync(dpy, False);
+}
+
+/* Applies geometry to the server without waiting for it.  Returns True if
+ * anything had to be sent. */
+Bool
+moveresize(Client * c, int x, int y, int w, int h) {
 	if (w <= 0 || h <= 0)
-		return;
+		return False;
 	/* offscreen appearance fixes */
 	if (x > DisplayWidth(dpy, screen))
 		x = DisplayWidth(dpy, screen) - w - 2 * c->border;
 	if (y > DisplayHeight(dpy, screen))
 		y = DisplayHeight(dpy, screen) - h - 2 * c->border;
-	if (w != c->w && c->th) {
+	if (w != c->w && c->title && !c->th)
+		freetitle(c);	/* would have to be redone anyway */
+	if (w != c->w && c->title) {
 		XMoveResizeWindow(dpy, c->title, 0, 0, w, c->th);
-		XFreePixmap(dpy, c->drawable);
-		c->drawable =
+		XFreePixmap(dpy, c->cold->drawable);
+		c->cold->drawable =
 			XCreatePixmap(dpy, root, w, c->th, DefaultDepth(dpy, screen));
 		drawclient(c);
 	}
@@ -1529,14 +1971,129 @@ resize(Client * c, int x, int y, int w, int h, Bool sizehints) {
 		XMoveResizeWindow(dpy, c->frame, c->x, c->y, c->w, c->h);
 		XMoveResizeWindow(dpy, c->win, 0, c->th, c->w, c->h - c->th);
 		configure(c);
-		XSync(dpy, False);
+		snapshotnotify();
+		return True;
+	}
+	return False;
+}
+
+/* Does the work held back by ratelimit() and titlelimit() once it is
+ * due, so a throttled client still ends up with its last title, hints
+ * and geometry.  Returns the microseconds until the next one is
+ * due, or -1 if nothing is held back. */
+long long
+ratecatchup(void) {
+	unsigned long long now, due;
+	long long next = -1;
+	Client *c;
+	int k;
+
+	if (!nratepending)
+		return -1;
+	now = timeus();
+	for (c = clients; c; c = c->next) {
+		if (!c->cold->ratepending)
+			continue;
+		for (k = 0; k < RateLast; k++) {
+			if (!(c->cold->ratepending & BIT(k)))
+				continue;
+			due = c->cold->rate[k].due;
+			if (now < due) {
+				if (next < 0 || (long long) (due - now) < next)
+					next = due - now;
+				continue;
+			}
+			c->cold->ratepending &= ~BIT(k);
+			switch (k) {
+			case RateTitle:
+				retitle(c);
+				break;
+			case RateHints:
+				updatesizehints(c);
+				break;
+			case RateConfigure:
+				configclient(c, &c->cold->pendingcr);
+				break;
+			}
+		}
+		if (!c->cold->ratepending)
+			nratepending--;
+	}
+	XFlush(dpy);	/* select() comes next */
+	return next;
+}
+
+/* Leaves the work for kind to ratecatchup(), to be done at due or later. */
+void
+holdback(Client * c, int kind, unsigned long long due) {
+	Rate *r = &c->cold->rate[kind];
+
+	if (!c->cold->ratepending)
+		nratepending++;
+	if (!(c->cold->ratepending & BIT(kind)) || due > r->due)
+		r->due = due;
+	c->cold->ratepending |= BIT(kind);
+}
+
+/* Counts an event of the given kind from c.  Returns False when c sent
+ * more than options.ratelimit of them during the last second; the caller
+ * then skips the work and ratecatchup() does it later.  The count of the
+ * second before is weighted by how much of it still lies in the window. */
+Bool
+ratelimit(Client * c, int kind) {
+	Rate *r = &c->cold->rate[kind];
+	unsigned long long now, age;
+	unsigned int n;
+
+	now = timeus();
+	age = now - r->start;
+	if (age >= 2000000) {
+		r->start = now;
+		r->last = r->count = 0;
+	} else if (age >= 1000000) {
+		r->start += 1000000;
+		r->last = r->count;
+		r->count = 0;
+	}
+	n = r->count + r->last * (1000000 - (now - r->start)) / 1000000;
+	r->count++;
+	r->total++;
+	if (!options.ratelimit || n < (unsigned int) options.ratelimit)
+		return True;
+	r->throttled++;
+	holdback(c, kind, r->start + 1000000);
+	return False;
+}
+
+/* Frees the titles that have been hidden for TITLEREAP seconds.  Returns
+ * the seconds until the next one is due, or -1 if none is hidden. */
+int
+reaptitles(void) {
+	static long next;
+	long now;
+	Client *c;
+
+	if (!nuntitled)
+		return -1;
+	now = time(NULL);
+	if (now < next)
+		return next - now;
+	next = now + TITLEREAP;
+	for (c = clients; c; c = c->next) {
+		if (!c->cold->untitled)
+			continue;
+		if (now - c->cold->untitled >= TITLEREAP)
+			freetitle(c);
+		else
+			next = min(next, c->cold->untitled + TITLEREAP);
 	}
+	XFlush(dpy);	/* select() comes next */
+	return nuntitled ? next - now : -1;
 }
 
 void
 restack(Monitor * m) {
 	Client *c;
-	XEvent ev;
 	Window *wl;
 	int i, n;
 
@@ -1576,41 +2133,99 @@ restack(Monitor * m) {
 	assert(i == n);
 	XRestackWindows(dpy, wl, n);
 	free(wl);
-	XSync(dpy, False);
-	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	ignoreenter();
+}
+
+/* Reads the title of c and draws it unless c is out of sight; expose()
+ * draws it once it shows up again. */
+void
+retitle(Client * c) {
+	updatetitle(c);
+	c->cold->titletime = timeus();
+	if (c->cold->ratepending & BIT(RateTitle)) {
+		c->cold->ratepending &= ~BIT(RateTitle);
+		if (!c->cold->ratepending)
+			nratepending--;
+	}
+	if (isvisible(c, NULL) && !c->isicon)
+		drawclient(c);
 }
 
 void
 run(void) {
-	fd_set rd;
-	int xfd;
+	fd_set rd, wr;
+	struct timeval tv;
+	int xfd, maxfd;
+	long long us;
+	char c;
 	XEvent ev;
+	StatsMark sm;
 
 	/* main event loop */
 	XSync(dpy, False);
 	xfd = ConnectionNumber(dpy);
 	while (running) {
+		/* before select(), events may have been queued while
+		 * waiting for a reply */
+		while (XPending(dpy)) {
+			XNextEvent(dpy, &ev);
+			if (handler[ev.type]) {
+				traceevent(&ev);
+				statsbegin(&sm);
+				(handler[ev.type]) (&ev);	/* call handler */
+				statsevent(ev.type, &sm);
+			}
+		}
+		if (!running)
+			break;
+		if (dumpstats) {
+			dumpstats = 0;
+			statsdump(stderr);
+		}
+		ipcflush();
+		snapshotupdate();
+		if ((us = runtimers()) >= 0) {
+			tv.tv_sec = us / 1000000;
+			tv.tv_usec = us % 1000000;
+		}
 		FD_ZERO(&rd);
+		FD_ZERO(&wr);
 		FD_SET(xfd, &rd);
-		if (select(xfd + 1, &rd, NULL, NULL, NULL) == -1) {
+		/* a SIGUSR1 coming after the test above still ends the wait */
+		if (sigpipe[0] >= 0)
+			FD_SET(sigpipe[0], &rd);
+		maxfd = ipcfds(&rd, &wr, max(xfd, sigpipe[0]));
+		if (select(maxfd + 1, &rd, &wr, NULL, us < 0 ? NULL : &tv) == -1) {
 			if (errno == EINTR)
 				continue;
 			eprint("select failed\n");
 		}
-		while (XPending(dpy)) {
-			XNextEvent(dpy, &ev);
-			if (handler[ev.type])
-				(handler[ev.type]) (&ev);	/* call handler */
-		}
+		if (sigpipe[0] >= 0 && FD_ISSET(sigpipe[0], &rd))
+			while (read(sigpipe[0], &c, 1) > 0);
+		ipchandle(&rd, &wr);
 	}
 }
 
+/* Does the work run() and replay() owe to timers: freeing titles hidden
+ * for long and catching up with throttled clients.  Returns the
+ * microseconds until more is due, or -1 if nothing is. */
+long long
+runtimers(void) {
+	long long us, t;
+
+	if ((t = reaptitles()) >= 0)
+		t *= 1000000;
+	if ((us = ratecatchup()) >= 0 && (t < 0 || us < t))
+		t = us;
+	return t;
+}
+
 void
 save(Client *c) {
-	c->rx = c->x;
-	c->ry = c->y;
-	c->rw = c->w;
-	c->rh = c->h;
+	c->cold->rx = c->x;
+	c->cold->ry = c->y;
+	c->cold->rw = c->w;
+	c->cold->rh = c->h;
 }
 
 void
@@ -1650,10 +2265,17 @@ setclientstate(Client * c, long state) {
 	long data[] = { state, None };
 	long winstate[2];
 
+	if (state == NormalState && c->isicon) {
+		dirtytiled();
+		c->isicon = False;
+	}
+	/* focus() asks for NormalState every time */
+	if (state == c->cold->wmstate)
+		return;
+	c->cold->wmstate = state;
 	XChangeProperty(dpy, c->win, atom[WMState], atom[WMState], 32,
 	    PropModeReplace, (unsigned char *) data, 2);
 	if (state == NormalState) {
-		c->isicon = False;
 		XDeleteProperty(dpy, c->win, atom[WindowState]);
 	} else {
 		winstate[0] = atom[WindowStateHidden];
@@ -1664,19 +2286,16 @@ setclientstate(Client * c, long state) {
 
 void
 setlayout(const char *arg) {
-	unsigned int i;
+	Layout *l;
 	Client *c;
 	Bool wasfloat;
 
 	wasfloat = FEATURES(curlayout, OVERLAP);
 
 	if (arg) {
-		for (i = 0; i < LENGTH(layouts); i++)
-			if (*arg == layouts[i].symbol)
-				break;
-		if (i == LENGTH(layouts))
+		if (!(l = getlayout(*arg)))
 			return;
-		views[curmontag].layout = &layouts[i];
+		views[curmontag].layout = l;
 	}
 	if (sel) {
 		for (c = clients; c; c = c->next) {
@@ -1715,33 +2334,29 @@ setmwfact(const char *arg) {
 }
 
 void
-initlayouts() {
-	unsigned int i, j;
+initview(unsigned int i) {
+	Layout *l;
 	char conf[32], ltname;
-	float mwfact;
 	int nmaster;
-	const char *deflayout;
 
-	/* init layouts */
-	mwfact = atof(getresource("mwfact", STR(DEFMWFACT)));
 	nmaster = atoi(getresource("nmaster", STR(DEFNMASTER)));
-	deflayout = getresource("deflayout", "i");
-	if (!nmaster)
-		nmaster = 1;
-	for (i = 0; i < ntags; i++) {
-		views[i].layout = &layouts[0];
-		snprintf(conf, sizeof(conf), "tags.layout%d", i);
-		strncpy(&ltname, getresource(conf, deflayout), 1);
-		for (j = 0; j < LENGTH(layouts); j++) {
-			if (layouts[j].symbol == ltname) {
-				views[i].layout = &layouts[j];
-				break;
-			}
-		}
-		views[i].mwfact = mwfact;
-		views[i].nmaster = nmaster;
-		views[i].barpos = StrutsOn;
-	}
+	snprintf(conf, sizeof(conf), "tags.layout%u", i);
+	strncpy(&ltname, getresource(conf, getresource("deflayout", "i")), 1);
+	views[i].layout = (l = getlayout(ltname)) ? l : &layouts[0];
+	views[i].mwfact = atof(getresource("mwfact", STR(DEFMWFACT)));
+	views[i].nmaster = nmaster ? nmaster : 1;
+	views[i].barpos = StrutsOn;
+	views[i].mru = NULL;
+	views[i].nmru = views[i].mrusize = 0;
+}
+
+void
+initlayouts() {
+	unsigned int i;
+
+	/* init layouts */
+	for (i = 0; i < ntags; i++)
+		initview(i);
 	updateatom[ELayout] (NULL);
 }
 
@@ -1761,6 +2376,7 @@ initmonitors(XEvent * e) {
 		m = monitors;
 		do {
 			t = m->next;
+			free(m->tiled);
 			free(m->seltags);
 			free(m->prevtags);
 			free(m);
@@ -1831,25 +2447,126 @@ initmonitors(XEvent * e) {
 	updateatom[WorkArea] (NULL);
 }
 
+char *
+inittag(unsigned int i) {
+	char tmp[32], def[16];
+
+	snprintf(tmp, sizeof(tmp), "tags.name%u", i);
+	snprintf(def, sizeof(def), "%u", i + 1);
+	return estrdup(getresource(tmp, def));
+}
+
 void
 inittags() {
 	unsigned int i;
-	char tmp[25] = "\0";
 
 	ntags = atoi(getresource("tags.number", "5"));
+	if (ntags < 1)
+		ntags = 1;
+	if (ntags > MAXTAGS)
+		ntags = MAXTAGS;
 	views = emallocz(ntags * sizeof(View));
 	tags = emallocz(ntags * sizeof(char *));
-	for (i = 0; i < ntags; i++) {
-		tags[i] = emallocz(25);
-		snprintf(tmp, sizeof(tmp), "tags.name%d", i);
-		snprintf(tags[i], sizeof(tags[i]), "%s", getresource(tmp,
-		    "null"));
+	for (i = 0; i < ntags; i++)
+		tags[i] = inittag(i);
+}
+
+/* Resizes a per tag Bool array from ntags to n entries. */
+Bool *
+resizetags(Bool *t, unsigned int n) {
+	Bool *nt;
+
+	nt = emallocz(n * sizeof(Bool));
+	memcpy(nt, t, min(n, ntags) * sizeof(Bool));
+	return nt;
+}
+
+/* Grows or shrinks the set of tags at runtime.  Clients left without a tag
+ * move to the last remaining one, as _NET_NUMBER_OF_DESKTOPS asks for. */
+void
+settags(unsigned int n) {
+	unsigned int i, j;
+	Monitor *m;
+	Client *c;
+	Bool *t;
+
+	if (n < 1 || n == ntags)
+		return;
+	for (i = n; i < ntags; i++) {
+		free(tags[i]);
+		free(views[i].mru);
+	}
+	tags = realloc(tags, n * sizeof(char *));
+	views = realloc(views, n * sizeof(View));
+	if (!tags || !views)
+		eprint("fatal: could not realloc() %u tags\n", n);
+	for (c = clients; c; c = c->next) {
+		if (c->isbastard)
+			continue;	/* these point to monitor's seltags */
+		t = resizetags(c->tags, n);
+		for (j = 0; j < n && !t[j]; j++);
+		if (j == n)
+			t[n - 1] = True;
+		if (c->tags != SLOTTAGS(c))
+			free(c->tags);
+		if (n <= pooltags) {
+			memcpy(SLOTTAGS(c), t, n * sizeof(Bool));
+			free(t);
+			t = SLOTTAGS(c);
+		}
+		c->tags = t;
+	}
+	for (m = monitors; m; m = m->next) {
+		t = resizetags(m->seltags, n);
+		if (m->curtag >= n)
+			m->curtag = n - 1;
+		for (j = 0; j < n && !t[j]; j++);
+		if (j == n)
+			t[m->curtag] = True;
+		for (c = clients; c; c = c->next)
+			if (c->isbastard && c->tags == m->seltags)
+				c->tags = t;
+		free(m->seltags);
+		m->seltags = t;
+		t = resizetags(m->prevtags, n);
+		free(m->prevtags);
+		m->prevtags = t;
+	}
+	i = ntags;
+	ntags = n;
+	for (; i < ntags; i++) {
+		tags[i] = inittag(i);
+		initview(i);
 	}
+	for (c = clients; c; c = c->next)
+		mruadd(c);	/* some moved to the last tag */
+	j = nkeys;
+	inittagkeys(ntags);
+	if (nkeys != j)
+		grabkeys();
+	dirtytiled();
+	for (c = clients; c; c = c->next)
+		updateatom[WindowDesk] (c);
+	updateatom[NumberOfDesk] (NULL);
+	updateatom[DeskNames] (NULL);
+	updateatom[WorkArea] (NULL);
+	for (m = monitors; m; m = m->next)
+		updategeom(m);
+	arrange(NULL);
+	focus(NULL);
 }
 
 void
 sighandler(int signum) {
-	if (signum == SIGHUP)
+	int e;
+
+	if (signum == SIGUSR1) {
+		dumpstats = 1;
+		/* a full pipe means run() is woken up already */
+		e = errno;
+		write(sigpipe[1], "", 1);
+		errno = e;
+	} else if (signum == SIGHUP)
 		quit("HUP!");
 	else
 		quit(NULL);
@@ -1892,7 +2609,7 @@ setup(char *conf) {
 	/* select for events */
 	wa.event_mask = SubstructureRedirectMask | SubstructureNotifyMask
 	    | EnterWindowMask | LeaveWindowMask | StructureNotifyMask |
-	    ButtonPressMask | ButtonReleaseMask;
+	    ButtonPressMask | ButtonReleaseMask | PropertyChangeMask;
 	wa.cursor = cursor[CurNormal];
 	XChangeWindowAttributes(dpy, root, CWEventMask | CWCursor, &wa);
 	XSelectInput(dpy, root, wa.event_mask);
@@ -1948,9 +2665,15 @@ setup(char *conf) {
 	options.command[LENGTH(options.command) - 1] = '\0';
 	options.dectiled = atoi(getresource("decoratetiled", STR(DECORATETILED)));
 	options.hidebastards = atoi(getresource("hidebastards", "0"));
+	options.monoclehide = atoi(getresource("monoclehide", "0"));
+	options.atomicswitch = atoi(getresource("atomicswitch", "1"));
 	options.focus = atoi(getresource("sloppy", "0"));
 	options.gap = atoi(getresource("gap", STR(DEFGAP)));
+	options.ratelimit = atoi(getresource("ratelimit", STR(RATELIMIT)));
+	options.titlerate = atoi(getresource("titlerate", STR(TITLERATE)));
 	options.snap = atoi(getresource("snap", STR(SNAP)));
+	ipcinit();
+	snapshotinit();
 
 	for (m = monitors; m; m = m->next) {
 		m->struts[RightStrut] = m->struts[LeftStrut] =
@@ -1995,110 +2718,36 @@ tag(const char *arg) {
 	for (i = 0; i < ntags; i++)
 		sel->tags[i] = (NULL == arg);
 	sel->tags[idxoftag(arg)] = True;
+	mruadd(sel);
+	dirtytiled();
 	updateatom[WindowDesk] (sel);
 	updateframe(sel);
 	arrange(NULL);
 	focus(NULL);
 }
 
-void
-bstack(Monitor * m) {
-	int i, n, nx, ny, nw, nh, mh, tw;
-	Client *c, *mc;
-
-	for (n = 0, c = nexttiled(clients, m); c; c = nexttiled(c->next, m))
-		n++;
-
-	mh = (n == 1) ? m->wah : views[m->curtag].mwfact * m->wah;
-	tw = (n > 1) ? m->waw / (n - 1) : 0;
-
-	nx = m->wax;
-	ny = m->way;
-	nh = 0;
-	for (i = 0, c = mc = nexttiled(clients, m); c; c = nexttiled(c->next, m), i++) {
-		c->ismax = False;
-		if (i == 0) {
-			nh = mh - 2 * c->border;
-			nw = m->waw - 2 * c->border;
-			nx = m->wax;
-		} else {
-			if (i == 1) {
-				nx = m->wax;
-				ny += mc->h + c->border;
-				nh = (m->way + m->wah) - ny - 2 * c->border;
-			}
-			if (i + 1 == n)
-				nw = (m->wax + m->waw) - nx - 2 * c->border;
-			else
-				nw = tw - c->border;
-		}
-		resize(c, nx, ny, nw, nh, False);
-		if (n > 1 && tw != curwaw)
-			nx = c->x + c->w + c->border;
-	}
-}
-
-void
-tile(Monitor * m) {
-	int nx, ny, nw, nh, mw, mh, g;
-	unsigned int i, n, th;
-	Client *c, *mc;
-
-	for (n = 0, c = nexttiled(clients, m); c; c = nexttiled(c->next, m))
-		n++;
-
-	/* window geoms */
-	mh = (n <= views[m->curtag].nmaster) ? m->wah / (n >
-	    0 ? n : 1) : m->wah / (views[m->curtag].nmaster ? views[m->curtag].nmaster : 1);
-	mw = (n <= views[m->curtag].nmaster) ? m->waw : views[m->curtag].mwfact * m->waw;
-	th = (n > views[m->curtag].nmaster) ? m->wah / (n - views[m->curtag].nmaster) : 0;
-	if (n > views[m->curtag].nmaster && th < style.titleheight)
-		th = m->wah;
-
-	nx = m->wax;
-	ny = m->way;
-	nw = 0;
-	g = 0;
-	for (i = 0, c = mc = nexttiled(clients, m); c; c = nexttiled(c->next, m), i++) {
-		c->ismax = False;
-		if (i < views[m->curtag].nmaster) {	/* master */
-			ny = m->way + i * (mh - c->border);
-			nw = mw - 2 * c->border;
-			nh = mh;
-			if (i + 1 == (n < views[m->curtag].nmaster ? n : views[m->curtag].nmaster))	/* remainder */
-				nh = m->way + m->wah - ny;
-			nh -= 2 * c->border;
-			/* gaps */
-			ny = ny + options.gap;
-			nx = nx + options.gap;
-			nh = nh - options.gap * 2;
-			nw = nw - options.gap * 2;
-		} else {	/* tile window */
-			if (i == views[m->curtag].nmaster) {
-				ny = m->way;
-				nx += mc->w + mc->border;
-				nw = m->waw - nx - 2 * c->border + m->wax;
-			} else
-				ny -= c->border;
-			if (i + 1 == n)	/* remainder */
-				nh = (m->way + m->wah) - ny - 2 * c->border;
-			else
-				nh = th - 2 * c->border;
-			/* gaps */
-			if (g == 0) {
-				g = 1;
-				nx = nx + options.gap;
-				nw = nw - options.gap * 2;
-			}
-			ny = ny + options.gap;
-			nh = nh - options.gap * 2;
-		}
-		resize(c, nx, ny, nw, nh, False);
-		if (n > views[m->curtag].nmaster && th != (unsigned int)m->wah) {
-			ny = c->y + c->h + 2 * c->border;
-		}
-	}
+/* Lets the first title change through and the ones after it at most
+ * options.titlerate times a second; ratecatchup() reads the title again
+ * when the next one is due, so the last change is never lost. */
+Bool
+titlelimit(Client * c) {
+	unsigned long long due;
+
+	if (options.titlerate <= 0)
+		return True;
+	due = c->cold->titletime + 1000000 / options.titlerate;
+	if (timeus() >= due)
+		return True;
+	holdback(c, RateTitle, due);
+	return False;
+}
 
+/* The tiled client of m that is shown when m's layout occludes the
+ * others: the one focused last.  manage() puts a new client first in the
+ * history, so it is the one shown once arranged. */
+Client *
+toptiled(Monitor * m) {
+	return nextfocus(m, True);
 }
 
 void
@@ -2119,10 +2768,11 @@ togglefloating(const char *arg) {
 		return;
 
 	sel->isfloating = !sel->isfloating;
+	dirtytiled();
 	updateframe(sel);
 	if (sel->isfloating) {
 		/* restore last known float dimensions */
-		resize(sel, sel->rx, sel->ry, sel->rw, sel->rh, False);
+		resize(sel, sel->cold->rx, sel->cold->ry, sel->cold->rw, sel->cold->rh, False);
 	} else {
 		/* save last known float dimensions */
 		save(sel);
@@ -2132,7 +2782,6 @@ togglefloating(const char *arg) {
 
 void
 togglefill(const char *arg) {
-	XEvent ev;
 	Monitor *m = curmonitor();
 	Client *c;
 	int x1, x2, y1, y2, w, h;
@@ -2172,14 +2821,13 @@ togglefill(const char *arg) {
 		save(sel);
 		resize(sel, x1, y1, w, h, True);
 	} else {
-		resize(sel, sel->rx, sel->ry, sel->rw, sel->rh, True);
+		resize(sel, sel->cold->rx, sel->cold->ry, sel->cold->rw, sel->cold->rh, True);
 	}
-	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	ignoreenter();
 }
 
 void
 togglemax(const char *arg) {
-	XEvent ev;
 	Monitor *m = curmonitor();
 
 	if (!sel || sel->isfixed || !sel->isfloating || MFEATURES(m, OVERLAP))
@@ -2191,9 +2839,9 @@ togglemax(const char *arg) {
 		resize(sel, m->sx - sel->border,
 		    m->sy - sel->border - sel->th, m->sw, m->sh + sel->th, False);
 	} else {
-		resize(sel, sel->rx, sel->ry, sel->rw, sel->rh, True);
+		resize(sel, sel->cold->rx, sel->cold->ry, sel->cold->rw, sel->cold->rh, True);
 	}
-	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	ignoreenter();
 }
 
 void
@@ -2207,6 +2855,8 @@ toggletag(const char *arg) {
 	for (j = 0; j < ntags && !sel->tags[j]; j++);
 	if (j == ntags)
 		sel->tags[i] = True;	/* at least one tag must be enabled */
+	mruadd(sel);
+	dirtytiled();
 	drawclient(sel);
 	arrange(NULL);
 }
@@ -2238,6 +2888,8 @@ toggleview(const char *arg) {
 
 	memcpy(cm->prevtags, cm->seltags, ntags * sizeof(cm->seltags[0]));
 	cm->seltags[i] = !cm->seltags[i];
+	dirtytiled();
+	batchbegin();
 	for (m = monitors; m; m = m->next) {
 		if (m->seltags[i] && m != cm) {
 			memcpy(m->prevtags, m->seltags, ntags * sizeof(m->seltags[0]));
@@ -2255,23 +2907,26 @@ toggleview(const char *arg) {
 	}
 	arrange(cm);
 	focus(NULL);
+	batchend();
 	updateatom[CurDesk] (NULL);
 }
 
 void
 focusview(const char *arg) {
 	Client *c;
-	int i;
+	int i, j;
 
 	toggleview(arg);
 	i = idxoftag(arg);
 	if (!curseltags[i])
 		return;
-	for (c = stack; c; c = c->snext) {
-		if (c->tags[i] && !c->isbastard) {
+	for (j = 0; j < views[i].nmru && !views[i].mru[j]->tags[i]; j++);
+	if (j < views[i].nmru)
+		focus(views[i].mru[j]);
+	else {
+		for (c = stack; c && !(c->tags[i] && !c->isbastard); c = c->snext);
+		if (c)
 			focus(c);
-			break;
-		}
 	}
 	restack(curmonitor());
 }
@@ -2290,6 +2945,26 @@ unban(Client * c) {
 	c->isbanned = False;
 }
 
+/* Shows c, a tiled client hidden by arrangemon() under the top one of an
+ * occluding layout, and hides the others.  Their geometry is left alone,
+ * so this costs a map and an unmap and no resizes. */
+void
+uncover(Client * c) {
+	Monitor *m;
+	Client **cl;
+	int i;
+
+	if (c->isfloating || c->isbastard || c->isicon
+	    || !(m = clientmonitor(c)) || !MFEATURES(m, OCCLUDE))
+		return;
+	unban(c);
+	cl = tiledclients(m);
+	for (i = 0; i < m->ntiled; i++)
+		if (cl[i] != c)
+			ban(cl[i]);
+	ignoreenter();
+}
+
 void
 unmanage(Client * c) {
 	Monitor *m;
@@ -2306,31 +2981,27 @@ unmanage(Client * c) {
 	XSelectInput(dpy, c->frame, NoEventMask);
 	XUnmapWindow(dpy, c->frame);
 	XSetErrorHandler(xerrordummy);
-	if (c->title) {
-		XftDrawDestroy(c->xftdraw);
-		XFreePixmap(dpy, c->drawable);
-		XDestroyWindow(dpy, c->title);
-		c->title = (Window) NULL;
-	}
 	XSelectInput(dpy, c->win, CLIENTMASK & ~(StructureNotifyMask | EnterWindowMask));
-	XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
 	XReparentWindow(dpy, c->win, root, c->x, c->y);
 	XMoveWindow(dpy, c->win, c->x, c->y);
 	if (!running)
 		XMapWindow(dpy, c->win);
-	wc.border_width = c->oldborder;
+	wc.border_width = c->cold->oldborder;
 	XConfigureWindow(dpy, c->win, CWBorderWidth, &wc);	/* restore border */
 	detach(c);
 	detachstack(c);
+	mrudrop(c);
+	ipcnotify(IpcClients, NULL);
 	if (sel == c)
 		focus(NULL);
+	/* after focus(), which would grab c's buttons again */
+	XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
 	setclientstate(c, WithdrawnState);
-	XDestroyWindow(dpy, c->frame);
-	/* c->tags points to monitor */
-	if (!c->isbastard)
-		free(c->tags);
-	free(c);
-	XSync(dpy, False);
+	XSync(dpy, False);	/* so freeframe() sees all events of c's frame */
+	freeframe(c);
+	if (c->cold->ratepending)
+		nratepending--;
+	freeclient(c);
 	XSetErrorHandler(xerror);
 	XUngrabServer(dpy);
 	if (dostruts) {
@@ -2344,6 +3015,7 @@ unmanage(Client * c) {
 
 void
 updategeom(Monitor * m) {
+	ipcnotify(IpcMonitors, NULL);
 	m->wax = m->sx;
 	m->way = m->sy;
 	m->waw = m->sw;
@@ -2380,9 +3052,9 @@ unmapnotify(XEvent * e) {
 	XUnmapEvent *ev = &e->xunmap;
 
 	if ((c = getclient(ev->window, clients, ClientWindow)) /* && ev->send_event */) {
-		if (c->ignoreunmap--)
+		if (c->cold->ignoreunmap--)
 			return;
-		DPRINTF("killing self-unmapped window (%s)\n", c->name);
+		DPRINTF("killing self-unmapped window (%s)\n", c->cold->name);
 		unmanage(c);
 	}
 }
@@ -2391,7 +3063,7 @@ void
 updateframe(Client * c) {
 	int i, f = 0;
 
-	if (!c->title)
+	if (!c->hastitle)
 		return;
 
 	for (i = 0; i < ntags; i++) {
@@ -2400,10 +3072,21 @@ updateframe(Client * c) {
 	}
 	c->th = !c->ismax && (c->isfloating || options.dectiled || f) ?
 				style.titleheight : 0;
-	if (!c->th)
-		XUnmapWindow(dpy, c->title);
-	else
-		XMapRaised(dpy, c->title);
+	if (!c->th) {
+		if (c->title && !c->cold->untitled) {
+			XUnmapWindow(dpy, c->title);
+			c->cold->untitled = time(NULL);
+			nuntitled++;
+		}
+		return;
+	}
+	if (!c->title)
+		createtitle(c);
+	else if (c->cold->untitled) {
+		c->cold->untitled = 0;
+		nuntitled--;
+	}
+	XMapRaised(dpy, c->title);
 }
 
 void
@@ -2413,48 +3096,56 @@ updatesizehints(Client * c) {
 
 	if (!XGetWMNormalHints(dpy, c->win, &size, &msize) || !size.flags)
 		size.flags = PSize;
-	c->flags = size.flags;
-	if (c->flags & PBaseSize) {
-		c->basew = size.base_width;
-		c->baseh = size.base_height;
-	} else if (c->flags & PMinSize) {
-		c->basew = size.min_width;
-		c->baseh = size.min_height;
+	c->cold->flags = size.flags;
+	if (c->cold->flags & PBaseSize) {
+		c->cold->basew = size.base_width;
+		c->cold->baseh = size.base_height;
+	} else if (c->cold->flags & PMinSize) {
+		c->cold->basew = size.min_width;
+		c->cold->baseh = size.min_height;
 	} else
-		c->basew = c->baseh = 0;
-	if (c->flags & PResizeInc) {
-		c->incw = size.width_inc;
-		c->inch = size.height_inc;
+		c->cold->basew = c->cold->baseh = 0;
+	if (c->cold->flags & PResizeInc) {
+		c->cold->incw = size.width_inc;
+		c->cold->inch = size.height_inc;
 	} else
-		c->incw = c->inch = 0;
-	if (c->flags & PMaxSize) {
-		c->maxw = size.max_width;
-		c->maxh = size.max_height;
+		c->cold->incw = c->cold->inch = 0;
+	if (c->cold->flags & PMaxSize) {
+		c->cold->maxw = size.max_width;
+		c->cold->maxh = size.max_height;
 	} else
-		c->maxw = c->maxh = 0;
-	if (c->flags & PMinSize) {
-		c->minw = size.min_width;
-		c->minh = size.min_height;
-	} else if (c->flags & PBaseSize) {
-		c->minw = size.base_width;
-		c->minh = size.base_height;
+		c->cold->maxw = c->cold->maxh = 0;
+	if (c->cold->flags & PMinSize) {
+		c->cold->minw = size.min_width;
+		c->cold->minh = size.min_height;
+	} else if (c->cold->flags & PBaseSize) {
+		c->cold->minw = size.base_width;
+		c->cold->minh = size.base_height;
 	} else
-		c->minw = c->minh = 0;
-	if (c->flags & PAspect) {
-		c->minax = size.min_aspect.x;
-		c->maxax = size.max_aspect.x;
-		c->minay = size.min_aspect.y;
-		c->maxay = size.max_aspect.y;
+		c->cold->minw = c->cold->minh = 0;
+	if (c->cold->flags & PAspect) {
+		c->cold->minax = size.min_aspect.x;
+		c->cold->maxax = size.max_aspect.x;
+		c->cold->minay = size.min_aspect.y;
+		c->cold->maxay = size.max_aspect.y;
 	} else
-		c->minax = c->maxax = c->minay = c->maxay = 0;
-	c->isfixed = (c->maxw && c->minw && c->maxh && c->minh
-	    && c->maxw == c->minw && c->maxh == c->minh);
+		c->cold->minax = c->cold->maxax = c->cold->minay = c->cold->maxay = 0;
+	c->isfixed = (c->cold->maxw && c->cold->minw && c->cold->maxh && c->cold->minh
+	    && c->cold->maxw == c->cold->minw && c->cold->maxh == c->cold->minh);
 }
 
 void
 updatetitle(Client * c) {
-	if (!gettextprop(c->win, atom[WindowName], c->name, sizeof(c->name)))
-		gettextprop(c->win, atom[WMName], c->name, sizeof(c->name));
+	char name[256];
+
+	if (!gettextprop(c->win, atom[WindowName], name, sizeof(name)))
+		gettextprop(c->win, atom[WMName], name, sizeof(name));
+	if (!c->cold->name || strcmp(c->cold->name, name)) {
+		free(c->cold->name);
+		c->cold->name = estrdup(name);
+		switcherindex(c);
+		ipcnotify(IpcTitle, c);
+	}
 }
 
 /* There's no way to check accesses to destroyed windows, thus those cases are
@@ -2507,8 +3198,10 @@ view(const char *arg) {
 	for (j = 0; j < ntags; j++)
 		cm->seltags[j] = (arg == NULL);
 	cm->seltags[i] = True;
+	dirtytiled();
 	prevtag = cm->curtag;
 	cm->curtag = i;
+	batchbegin();
 	for (m = monitors; m; m = m->next) {
 		if (m->seltags[i] && m != cm) {
 			m->curtag = prevtag;
@@ -2521,6 +3214,7 @@ view(const char *arg) {
 	updategeom(cm);
 	arrange(cm);
 	focus(NULL);
+	batchend();
 	updateatom[CurDesk] (NULL);
 }
 
@@ -2538,10 +3232,13 @@ viewprevtag(const char *arg) {
 	memcpy(tmptags, curseltags, ntags * sizeof(curseltags[0]));
 	memcpy(curseltags, curprevtags, ntags * sizeof(curseltags[0]));
 	memcpy(curprevtags, tmptags, ntags * sizeof(curseltags[0]));
+	dirtytiled();
 	if (views[prevcurtag].barpos != views[curmontag].barpos)
 		updategeom(curmonitor());
+	batchbegin();
 	arrange(NULL);
 	focus(NULL);
+	batchend();
 	updateatom[CurDesk] (NULL);
 }
 
@@ -2571,44 +3268,73 @@ viewrighttag(const char *arg) {
 
 void
 zoom(const char *arg) {
-	Client *c;
+	Client *c, **cl;
+	Monitor *m;
 
 	if (!sel || !FEATURES(curlayout, ZOOM) || sel->isfloating)
 		return;
-	if ((c = sel) == nexttiled(clients, curmonitor()))
-		if (!(c = nexttiled(c->next, curmonitor())))
+	if (!(m = curmonitor()))
+		return;
+	cl = tiledclients(m);
+	if ((c = sel) == (m->ntiled ? cl[0] : NULL))
+		if (!(c = (m->ntiled > 1) ? cl[1] : NULL))
 			return;
 	detach(c);
 	attach(c, 0);
-	arrange(curmonitor());
+	arrange(m);
 	focus(c);
 }
 
 int
 main(int argc, char *argv[]) {
 	char conf[256] = "\0";
+	char *trace = NULL;
+	Bool replaying = False;
+	int i;
 
-	if (argc == 3 && !strcmp("-f", argv[1]))
-		snprintf(conf, sizeof(conf), "%s", argv[2]);
-	else if (argc == 2 && !strcmp("-v", argv[1]))
-		eprint("echinus-" VERSION " (c) 2011 Alexander Polakov\n");
-	else if (argc != 1)
-		eprint("usage: echinus [-v] [-f conf]\n");
+	for (i = 1; i < argc; i++) {
+		if (argc == 2 && !strcmp("-v", argv[i]))
+			eprint("echinus-" VERSION " (c) 2011 Alexander Polakov\n");
+		else if (i + 1 < argc && !strcmp("-f", argv[i]))
+			snprintf(conf, sizeof(conf), "%s", argv[++i]);
+		else if (i + 1 < argc && !trace && !strcmp("-r", argv[i]))
+			trace = argv[++i];
+		else if (i + 1 < argc && !trace && !strcmp("-R", argv[i])) {
+			trace = argv[++i];
+			replaying = True;
+		} else
+			eprint("usage: echinus [-v] [-f conf] [-r trace | -R trace]\n");
+	}
 
 	setlocale(LC_CTYPE, "");
 	if (!(dpy = XOpenDisplay(0)))
 		eprint("echinus: cannot open display\n");
+	if (pipe(sigpipe) == 0)
+		for (i = 0; i < 2; i++) {
+			fcntl(sigpipe[i], F_SETFD, FD_CLOEXEC);
+			fcntl(sigpipe[i], F_SETFL, O_NONBLOCK);
+		}
 	signal(SIGHUP, sighandler);
 	signal(SIGINT, sighandler);
 	signal(SIGQUIT, sighandler);
+	signal(SIGUSR1, sighandler);
 	cargv = argv;
 	screen = DefaultScreen(dpy);
 	root = RootWindow(dpy, screen);
 
 	checkotherwm();
 	setup(conf);
-	scan();
-	run();
+	if (replaying) {
+		traceopen(trace, True);
+		replay();
+	} else {
+		scan();
+		if (trace) {
+			traceopen(trace, False);
+			tracestart();
+		}
+		run();
+	}
 	cleanup();
 
 	XCloseDisplay(dpy);
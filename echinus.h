@@ -12,12 +12,35 @@ enum { ClientList, ActiveWindow, WindowDesk,
 }; /* keep in sync with atomnames[][] in ewmh.c */
 
 enum { LeftStrut, RightStrut, TopStrut, BotStrut, LastStrut }; /* ewmh struts */
+enum { StrutsOn, StrutsOff, StrutsHide };		    /* struts position */
 enum { ColFG, ColBG, ColBorder, ColButton, ColLast };	/* colors */
 enum { ClientWindow, ClientTitle, ClientFrame };	/* client parts */
 enum { Iconify, Maximize, Close, LastBtn }; /* window buttons */
 
 /* typedefs */
 typedef struct Monitor Monitor;
+typedef struct Client Client;
+typedef struct View View;
+
+typedef struct {
+	int x, y, w, h;
+} Geometry;
+
+typedef struct {
+	Window frame;
+	int depth;
+	Visual *visual;
+	Window title;		/* None, or with the two below */
+	Pixmap drawable;
+	XftDraw *xftdraw;
+	int tw;			/* width of title and drawable */
+} Frame;			/* see allocframe() */
+
+typedef struct {
+	Visual *visual;
+	Colormap colormap;
+	int refs;		/* frames using it */
+} Cmap;				/* see getcolormap() */
 struct Monitor {
 	int sx, sy, sw, sh, wax, way, waw, wah;
 	unsigned long struts[LastStrut];
@@ -26,10 +49,14 @@ struct Monitor {
 	Monitor *next;
 	int mx, my;
 	unsigned int curtag;
+	Client **tiled;		/* visible tiled clients, see tiledclients() */
+	int ntiled, tiledsize;
+	Bool tiledok;
 };
 
 typedef struct {
-	void (*arrange) (Monitor * m);
+	/* fills g[i] for each of the n tiled clients cl[i]; no X requests */
+	void (*arrange) (Monitor * m, View * v, Client ** cl, Geometry * g, int n);
 	char symbol;
 	int features;
 #define BIT(_i)	(1 << (_i))
@@ -37,43 +64,79 @@ typedef struct {
 #define NMASTER	BIT(1)
 #define	ZOOM	BIT(2)
 #define	OVERLAP	BIT(3)
+#define	OCCLUDE	BIT(4)	/* tiled clients cover each other completely */
 } Layout;
 
 #define FEATURES(_layout, _which) (!(!((_layout)->features & (_which))))
 #define M2LT(_mon) (views[(_mon)->curtag].layout)
 #define MFEATURES(_monitor, _which) ((_monitor) && FEATURES(M2LT(_monitor), (_which)))
 
-typedef struct Client Client;
-struct Client {
-	char name[256];
-	int x, y, w, h;
+enum { RateTitle, RateHints, RateConfigure, RateLast };	/* see ratelimit() */
+
+typedef struct {
+	unsigned long long start;	/* of the current second, in us */
+	unsigned int count, last;	/* events in it and in the one before */
+	unsigned long total, throttled;
+	unsigned long long due;		/* of the held back work, see holdback() */
+} Rate;
+
+typedef struct {
 	int rx, ry, rw, rh;	/* revert geometry */
-	int th;			/* title height */
 	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
 	int minax, maxax, minay, maxay;
-	int ignoreunmap;
 	long flags;
-	int border, oldborder;
-	Bool isbanned, ismax, isfloating, wasfloating;
-	Bool isicon, isfill;
-	Bool isfixed, isbastard, isfocusable, hasstruts;
-	Bool *tags;
+	int oldborder;
+	int ignoreunmap;
+	long untitled;		/* when title was hidden, see reaptitles() */
+	long wmstate;		/* last WM_STATE written, see setclientstate() */
+	int framedepth;
+	Visual *framevisual;
+	unsigned int opacity;	/* when focused, from rules */
+	unsigned int shownopacity;	/* last written, see setopacity() */
+	char *name;		/* see updatetitle() */
+	char *class;		/* WM_CLASS class, see applyrules() */
+	char *skey;		/* search key, see switcherindex() */
+	Rate rate[RateLast];
+	int ratepending;	/* BIT(Rate*) left to ratecatchup() */
+	unsigned long long titletime;	/* last read, see titlelimit() */
+	XConfigureRequestEvent pendingcr;	/* merged, see configurerequest() */
+	Pixmap drawable;
+	XftDraw *xftdraw;
+} ClientCold;
+
+/* What arrange(), restack() and the list walks look at.  Everything else
+ * is in cold, which lives in a separate slab so that clients allocated
+ * together stay a few cache lines apart, see allocclient(). */
+struct Client {
 	Client *next;
 	Client *prev;
 	Client *snext;
+	Bool *tags;		/* in the pool slot, see allocclient() */
+	int x, y, w, h;
+	int th;			/* title height */
+	int border;
+	/* tested on every walk, see isvisible() and nexttiled(): plain
+	 * fields, as masking bitfields costs more than the bytes save */
+	Bool isbanned, isfloating, isicon, isbastard;
+	unsigned int ismax:1, wasfloating:1, isfill:1;
+	unsigned int isfixed:1, isfocusable:1, hasstruts:1;
+	unsigned int hide:1;	/* see arrangemon() */
+	unsigned int hastitle:1;	/* decorated; title is made on demand */
 	Window win;
-	Window title;
+	Window title;		/* None until shown, see createtitle() */
 	Window frame;
-	Pixmap drawable;
-	XftDraw *xftdraw;
+	unsigned long focusseq;	/* orders the focus history, see mrupush() */
+	ClientCold *cold;
 };
 
-typedef struct View {
+struct View {
 	int barpos;
 	int nmaster;
 	double mwfact;
 	Layout *layout;
-} View; /* per-tag settings */
+	Client **mru;		/* last focused first, see mrupush() */
+	int nmru, mrusize;
+}; /* per-tag settings */
 
 typedef struct {
 	Pixmap pm;
@@ -103,13 +166,35 @@ typedef struct {
 	KeySym keysym;
 	void (*func) (const char *arg);
 	const char *arg;
+	int tag;		/* per tag binding: index of the tag or -1 */
+	const char *name;	/* action name, for stats */
 } Key; /* keyboard shortcuts */
 
+typedef struct {
+	const char *name;
+	void (*action) (const char *arg);
+} KeyItem; /* actions that can be bound to keys */
+
+typedef struct {
+	Bool atomicswitch;
+	Bool attachaside;
+	Bool dectiled;
+	Bool hidebastards;
+	Bool monoclehide;
+	int focus;
+	int gap;
+	int ratelimit;
+	int snap;
+	int titlerate;
+	char command[255];
+} Options;
+
 typedef struct {
 	char *prop;
 	char *tags;
 	Bool isfloating;
 	Bool hastitle;
+	double opacity;
 	regex_t *propregex;
 	regex_t *tagregex;
 } Rule; /* window matching rules */
@@ -117,6 +202,7 @@ typedef struct {
 /* ewmh.c */
 Bool checkatom(Window win, Atom bigatom, Atom smallatom);
 void clientmessage(XEvent * e);
+void ewmh_process_desktop_names(void);
 void ewmh_process_state_atom(Client * c, Atom state, int set);
 void *getatom(Window win, Atom atom, unsigned long *nitems);
 void initewmh(void);
@@ -129,8 +215,10 @@ int getstruts(Client * c);
 void arrange(Monitor * m);
 Monitor *clientmonitor(Client * c);
 Monitor *curmonitor();
+void dirtytiled(void);
 void *emallocz(unsigned int size);
 void eprint(const char *errstr, ...);
+char *estrdup(const char *s);
 const char *getresource(const char *resource, const char *defval);
 Client *getclient(Window w, Client * list, int part);
 Monitor *getmonitor(int x, int y);
@@ -145,9 +233,14 @@ void focusview(const char *arg);
 void killclient(const char *arg);
 void moveresizekb(const char *arg);
 void quit(const char *arg);
+void resize(Client * c, int x, int y, int w, int h, Bool sizehints);
+void restack(Monitor * m);
 void restart(const char *arg);
+long long runtimers(void);
+void save(Client * c);
 void setmwfact(const char *arg);
 void setlayout(const char *arg);
+void settags(unsigned int n);
 void spawn(const char *arg);
 void tag(const char *arg);
 void togglestruts(const char *arg);
@@ -164,12 +257,66 @@ void viewprevtag(const char *arg);
 void viewrighttag(const char *arg);
 void zoom(const char *arg);
 
+/* layout.c */
+Layout *getlayout(char symbol);
+
+/* ipc.c (ipcfds() and ipchandle() are declared in echinus.c, which
+ * has <sys/select.h>) */
+enum { IpcFocus = 1, IpcView = 2, IpcLayout = 4, IpcClients = 8,
+	IpcTitle = 16, IpcMonitors = 32, IpcAll = 63 };	/* ipcnotify() */
+void ipcclose(void);
+void ipcflush(void);
+void ipcinit(void);
+void ipcnotify(unsigned int what, Client * c);
+
 /* parse.c */
 void initrules();
 int initkeys();
+void inittagkeys(unsigned int n);
+KeyItem *getkeyitem(const char *name, Bool *bytag);
+
+/* pool.c */
+#define SLOTTAGS(_c)	((Bool *) ((_c) + 1))	/* tags in c's slot */
+Client *allocclient(void);
+void freeclient(Client * c);
+extern unsigned int pooltags;
+
+/* snapshot.c */
+void snapshotclose(void);
+void snapshotinit(void);
+void snapshotnotify(void);
+void snapshotupdate(void);
+
+/* stats.c */
+typedef struct {
+	unsigned long long start;
+	unsigned long request;
+	unsigned long roundtrips;
+} StatsMark;
+void statsaction(const char *name, StatsMark * sm);
+void statsbegin(StatsMark * sm);
+void statsdump(FILE * f);
+void statsevent(int type, StatsMark * sm);
+unsigned long long timeus(void);
+
+/* trace.c */
+void replay(void);
+void traceclose(void);
+void traceevent(XEvent * ev);
+void tracemanage(Client * c);
+int tracemaskevent(Display * d, long mask, XEvent * ev);
+void traceopen(const char *path, Bool replay);
+void tracestart(void);
+
+/* switcher.c */
+void switcher(const char *arg);
+void switcherindex(Client * c);
+void switchto(Client * c);
 
 /* draw.c */
 void drawclient(Client * c);
+void drawswitcher(Window w, Pixmap pm, XftDraw * xd, unsigned int width,
+    const char *query, Client ** list, int n, int cur);
 void deinitstyle();
 void initstyle();
 
@@ -209,6 +356,7 @@ void initstyle();
 
 /* globals */
 extern Atom atom[NATOMS];
+extern void (*handler[LASTEvent]) (XEvent *);
 extern Display *dpy;
 extern Window root;
 extern Client *clients;
@@ -225,5 +373,30 @@ extern char **tags;
 extern Key **keys;
 extern Rule **rules;
 extern Layout layouts[];
+extern Options options;
 extern unsigned int modkey;
 extern View *views;
+extern int ncmaps;
+extern unsigned long enterserial;
+extern int nratepending;
+extern int nframes;
+
+/* Requests waiting for a reply are counted for stats.c.  Xlib doesn't
+ * expand these recursively, so the real functions are still called. */
+enum { RtSync, RtQueryPointer, RtGetProperty, RtOther, RtLast };
+extern unsigned long roundtrips[RtLast];
+#define ROUNDTRIP(_kind, _call)	(roundtrips[(_kind)]++, (_call))
+#define XSync(...)		ROUNDTRIP(RtSync, XSync(__VA_ARGS__))
+#define XQueryPointer(...)	ROUNDTRIP(RtQueryPointer, XQueryPointer(__VA_ARGS__))
+#define XGetWindowProperty(...)	ROUNDTRIP(RtGetProperty, XGetWindowProperty(__VA_ARGS__))
+#define XGetTextProperty(...)	ROUNDTRIP(RtGetProperty, XGetTextProperty(__VA_ARGS__))
+#define XGetClassHint(...)	ROUNDTRIP(RtGetProperty, XGetClassHint(__VA_ARGS__))
+#define XGetTransientForHint(...) ROUNDTRIP(RtGetProperty, XGetTransientForHint(__VA_ARGS__))
+#define XGetWMHints(...)	ROUNDTRIP(RtGetProperty, XGetWMHints(__VA_ARGS__))
+#define XGetWMNormalHints(...)	ROUNDTRIP(RtGetProperty, XGetWMNormalHints(__VA_ARGS__))
+#define XGetWindowAttributes(...) ROUNDTRIP(RtOther, XGetWindowAttributes(__VA_ARGS__))
+#define XQueryTree(...)		ROUNDTRIP(RtOther, XQueryTree(__VA_ARGS__))
+
+/* Modal loops take their events from the trace when replaying and have
+ * them recorded otherwise (see trace.c). */
+#define XMaskEvent(...)		tracemaskevent(__VA_ARGS__)
@@ -185,20 +185,59 @@ ewmh_update_net_work_area(void *p) {
 
 void
 ewmh_update_net_desktop_names(void *p) {
-	char buf[1024], *pos;
+	char *buf, *pos;
 	unsigned int i;
-	int len = 0;
+	size_t len = 0;
 
-	pos = buf;
+	for (i = 0; i < ntags; i++)
+		len += strlen(tags[i]) + 1;
+	pos = buf = emallocz(len);
 	for (i = 0; i < ntags; i++) {
-		snprintf(pos, strlen(tags[i]) + 1, "%s", tags[i]);
-		pos += (strlen(tags[i]) + 1);
+		strcpy(pos, tags[i]);
+		pos += strlen(tags[i]) + 1;
 	}
-	len = pos - buf;
 
 	XChangeProperty(dpy, root,
 	    atom[DeskNames], atom[Utf8String], 8, PropModeReplace,
 	    (unsigned char *) buf, len);
+	free(buf);
+}
+
+/* Pagers rename desktops by changing _NET_DESKTOP_NAMES on the root
+ * window.  Names beyond the number of desktops are reserved for desktops
+ * added later, so they are ignored. */
+void
+ewmh_process_desktop_names(void) {
+	Atom real;
+	int format;
+	unsigned long n, extra;
+	unsigned char *data = NULL;
+	char *pos, *end;
+	unsigned int i;
+	Bool changed = False;
+
+	if (XGetWindowProperty(dpy, root, atom[DeskNames], 0L, 0x7fffffffL,
+		False, atom[Utf8String], &real, &format, &n, &extra,
+		&data) != Success || !data || format != 8) {
+		XFree(data);
+		return;
+	}
+	/* Xlib terminates the data, so the last name is safe to strlen() */
+	end = (char *) data + n;
+	for (i = 0, pos = (char *) data; i < ntags && pos < end;
+	    i++, pos += strlen(pos) + 1) {
+		if (!*pos || !strcmp(pos, tags[i]))
+			continue;
+		free(tags[i]);
+		tags[i] = estrdup(pos);
+		changed = True;
+	}
+	XFree(data);
+	/* our own update triggers this again, only republish on change */
+	if (changed) {
+		updateatom[DeskNames] (NULL);
+		snapshotnotify();
+	}
 }
 
 void
@@ -228,7 +267,7 @@ mwm_process_atom(Client *c) {
 		(unsigned char **) &data) == Success && n >= MWM_HINTS_ELEMENTS) {
 		hint = (CARD32 *) data;
 		if (MWM_HINTS_DECOR(hint[0]) && !(MWM_DECOR_ALL(hint[2]))) {
-			c->title = MWM_DECOR_TITLE(hint[2]) ? root : (Window) NULL;
+			c->hastitle = MWM_DECOR_TITLE(hint[2]) ? True : False;
 			c->border = MWM_DECOR_BORDER(hint[2]) ? style.border : 0;
 		}
 	}
@@ -260,7 +299,7 @@ ewmh_process_state_atom(Client *c, Atom state, int set) {
 		    PropModeReplace, (unsigned char *) data, 2);
 		DPRINT;
 		arrange(curmonitor());
-		DPRINTF("%s: x%d y%d w%d h%d\n", c->name, c->x, c->y, c->w, c->h);
+		DPRINTF("%s: x%d y%d w%d h%d\n", c->cold->name, c->x, c->y, c->w, c->h);
 	}
 	if (state == atom[WindowStateModal])
 		focus(c);
@@ -278,11 +317,16 @@ clientmessage(XEvent *e) {
 	else if (ev->message_type == atom[ActiveWindow]) {
 		if ((c = getclient(ev->window, clients, ClientWindow))) {
 				c->isicon = False;
+				dirtytiled();
 				focus(c);
 				arrange(curmonitor());
 		}
 	} else if (ev->message_type == atom[CurDesk]) {
-		view(tags[ev->data.l[0]]);
+		if (ev->data.l[0] >= 0 && ev->data.l[0] < ntags)
+			view(tags[ev->data.l[0]]);
+	} else if (ev->message_type == atom[NumberOfDesk]) {
+		if (ev->data.l[0] > 0 && ev->data.l[0] <= MAXTAGS)
+			settags(ev->data.l[0]);
 	} else if (ev->message_type == atom[WindowState]) {
 		if ((c = getclient(ev->window, clients, ClientWindow))) {
 			ewmh_process_state_atom(c, (Atom) ev->data.l[1], ev->data.l[0]);
@@ -300,8 +344,12 @@ clientmessage(XEvent *e) {
 	}
 }
 
+/* Only writes when the value changes: every write wakes the compositor. */
 void
 setopacity(Client *c, unsigned int opacity) {
+	if (opacity == c->cold->shownopacity)
+		return;
+	c->cold->shownopacity = opacity;
 	if (opacity == OPAQUE) {
 		XDeleteProperty(dpy, c->win, atom[WindowOpacity]);
 		XDeleteProperty(dpy, c->frame, atom[WindowOpacity]);
@@ -0,0 +1,747 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains the control socket
+ *
+ *  A UNIX domain socket served from the select() loop in run().  Clients
+ *  send one command per line, the name of a key action followed by its
+ *  argument (view and friends take a tag name or index), or one of the
+ *  commands in ipccmds[].  Every command is answered with any number of
+ *  data lines followed by "ok" or "error <reason>", so scripts can
+ *  pipeline requests on one connection without forking anything.
+ *
+ *  After "subscribe" a connection also gets "event ..." lines.  Changes
+ *  are only flagged while handling events (ipcnotify()); right before
+ *  run() sleeps again ipcflush() compares the state with what was
+ *  published last and sends the differences, closed by "event end".  So
+ *  a burst of X events makes one batch and nothing is looked up on the
+ *  server.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE		/* struct ucred */
+#include <regex.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+#include "config.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+#define MAXCONNS	16
+#define LINESIZE	1024
+#define MAXOUT		(1 << 20)	/* drop clients that stop reading */
+
+typedef struct {
+	int fd;
+	char in[LINESIZE];
+	size_t inlen;
+	Bool discarding;		/* in a line that was too long */
+	char *out;
+	size_t outlen, outsize;
+	unsigned int subscribed;	/* Ipc* events wanted */
+	Bool pending;			/* events sent, "event end" is due */
+} Conn;
+
+typedef struct {
+	char *tags;		/* seltags as a string of 0 and 1 */
+	unsigned int curtag;
+	char symbol;
+	double mwfact;
+	int nmaster;
+	Geometry g;
+} MonState; /* what subscribers last heard about a monitor */
+
+typedef struct {
+	const char *name;
+	void (*func) (const char *arg);
+} IpcCmd;
+
+static void ipcclients(const char *arg);
+static void ipcfocus(const char *arg);
+static void ipcmoveresize(const char *arg);
+static void ipcstats(const char *arg);
+static void ipcsubscribe(const char *arg);
+
+static IpcCmd ipccmds[] = {
+	{ "clients",	ipcclients	},
+	{ "focus",	ipcfocus	},
+	{ "moveresize",	ipcmoveresize	},
+	{ "stats",	ipcstats	},
+	{ "subscribe",	ipcsubscribe	},
+};
+
+static const char *ipcevents[] = {
+	"focus", "view", "layout", "clients", "title", "monitors"
+}; /* in the order of the Ipc* bits */
+
+static int sock = -1;
+static struct sockaddr_un addr;
+static Conn conns[MAXCONNS];
+static int nconns;
+static Conn *cur;	/* connection being answered */
+
+/* subscriptions */
+static int nsubscribers;
+static unsigned int dirty;
+static Window lastfocus;
+static MonState *lastmons;
+static int nlastmons;
+static Window *lastclients, *titled;
+static int nlastclients, ntitled, lastclientsize, titledsize;
+
+static void
+append(Conn * c, const char *s, size_t len) {
+	if (c->outlen + len > c->outsize) {
+		c->outsize = max(c->outsize * 2, c->outlen + len);
+		if (!(c->out = realloc(c->out, c->outsize)))
+			eprint("fatal: could not realloc() %u bytes\n",
+			    (unsigned int) c->outsize);
+	}
+	memcpy(c->out + c->outlen, s, len);
+	c->outlen += len;
+}
+
+static int
+format(char *buf, size_t size, const char *fmt, va_list ap) {
+	int len;
+
+	len = vsnprintf(buf, size - 1, fmt, ap);
+	len = min(len, (int) size - 2);
+	buf[len++] = '\n';
+	return len;
+}
+
+static void
+reply(const char *fmt, ...) {
+	char buf[LINESIZE];
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = format(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	append(cur, buf, len);
+}
+
+static Client *
+argclient(const char *arg, const char **rest) {
+	unsigned long w;
+	char *end;
+	Client *c;
+
+	if (!arg)
+		return NULL;
+	w = strtoul(arg, &end, 0);
+	if (end == arg || !(c = getclient(w, clients, ClientWindow)))
+		return NULL;
+	if (rest)
+		*rest = end;
+	return c;
+}
+
+static void
+ipcclients(const char *arg) {
+	char tagstr[ntags + 1];
+	unsigned int i;
+	Client *c;
+
+	for (c = clients; c; c = c->next) {
+		for (i = 0; i < ntags; i++)
+			tagstr[i] = c->tags[i] ? '1' : '0';
+		tagstr[ntags] = '\0';
+		reply("client window=0x%lx tags=%s x=%d y=%d w=%d h=%d "
+		    "floating=%d icon=%d focused=%d name=%s", c->win, tagstr,
+		    c->x, c->y, c->w, c->h, c->isfloating, c->isicon, c == sel,
+		    c->cold->name);
+	}
+	reply("ok");
+}
+
+static void
+ipcfocus(const char *arg) {
+	Client *c;
+
+	if (!(c = argclient(arg, NULL))) {
+		reply("error no such client");
+		return;
+	}
+	switchto(c);
+	reply("ok");
+}
+
+/* moveresize <window> <x> <y> <w> <h>, in client window coordinates
+ * like a ConfigureRequest */
+static void
+ipcmoveresize(const char *arg) {
+	int x, y, w, h;
+	Client *c;
+
+	if (!(c = argclient(arg, &arg))
+	    || sscanf(arg, "%d %d %d %d", &x, &y, &w, &h) != 4) {
+		reply("error usage: moveresize <window> <x> <y> <w> <h>");
+		return;
+	}
+	if (!c->isfloating && !MFEATURES(clientmonitor(c), OVERLAP)) {
+		reply("error client is tiled");
+		return;
+	}
+	resize(c, x, y, w, h + c->th, True);
+	save(c);
+	reply("ok");
+}
+
+static void
+ipcstats(const char *arg) {
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f;
+
+	if (!(f = open_memstream(&buf, &len))) {
+		reply("error %s", strerror(errno));
+		return;
+	}
+	statsdump(f);
+	fclose(f);
+	append(cur, buf, len);
+	free(buf);
+	reply("ok");
+}
+
+/* Sends a line to c, or to every subscriber of what if c is NULL. */
+static void
+event(Conn * c, unsigned int what, const char *fmt, ...) {
+	char buf[LINESIZE];
+	va_list ap;
+	int i, len;
+
+	va_start(ap, fmt);
+	len = format(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (c) {
+		if (c->subscribed & what)
+			append(c, buf, len);
+		return;
+	}
+	for (i = 0; i < nconns; i++)
+		if (conns[i].subscribed & what) {
+			append(&conns[i], buf, len);
+			conns[i].pending = True;
+		}
+}
+
+static void
+growwindows(Window ** w, int *size, int n) {
+	if (n <= *size)
+		return;
+	*size = max(*size * 2, n);
+	if (!(*w = realloc(*w, *size * sizeof(Window))))
+		eprint("fatal: could not realloc() %u bytes\n",
+		    (unsigned int) (*size * sizeof(Window)));
+}
+
+static int
+cmpwindow(const void *a, const void *b) {
+	Window x = *(Window *) a, y = *(Window *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void
+difffocus(Conn * to) {
+	Window w = sel ? sel->win : None;
+
+	if (!to && w == lastfocus)
+		return;
+	event(to, IpcFocus, "event focus window=0x%lx", w);
+	lastfocus = w;
+}
+
+static void
+diffmonitors(Conn * to) {
+	char tagstr[ntags + 1];
+	unsigned int i;
+	MonState *ms;
+	Monitor *m;
+	View *v;
+	int n;
+
+	for (n = 0, m = monitors; m; m = m->next, n++);
+	for (; nlastmons > n; nlastmons--)
+		free(lastmons[nlastmons - 1].tags);
+	if (nlastmons < n) {
+		if (!(lastmons = realloc(lastmons, n * sizeof(MonState))))
+			eprint("fatal: could not realloc() %u bytes\n",
+			    (unsigned int) (n * sizeof(MonState)));
+		memset(lastmons + nlastmons, 0, (n - nlastmons) * sizeof(MonState));
+		nlastmons = n;
+	}
+	for (n = 0, m = monitors; m; m = m->next, n++) {
+		ms = &lastmons[n];
+		v = &views[m->curtag];
+		for (i = 0; i < ntags; i++)
+			tagstr[i] = m->seltags[i] ? '1' : '0';
+		tagstr[ntags] = '\0';
+		if (to || !ms->tags || strcmp(ms->tags, tagstr)
+		    || ms->curtag != m->curtag) {
+			event(to, IpcView, "event view monitor=%d tags=%s current=%u",
+			    n, tagstr, m->curtag);
+			free(ms->tags);
+			ms->tags = estrdup(tagstr);
+			ms->curtag = m->curtag;
+		}
+		if (to || ms->symbol != v->layout->symbol
+		    || ms->mwfact != v->mwfact || ms->nmaster != v->nmaster) {
+			event(to, IpcLayout, "event layout monitor=%d symbol=%c "
+			    "mwfact=%.2f nmaster=%d", n, v->layout->symbol,
+			    v->mwfact, v->nmaster);
+			ms->symbol = v->layout->symbol;
+			ms->mwfact = v->mwfact;
+			ms->nmaster = v->nmaster;
+		}
+		if (to || ms->g.x != m->sx || ms->g.y != m->sy
+		    || ms->g.w != m->sw || ms->g.h != m->sh) {
+			event(to, IpcMonitors, "event monitor index=%d x=%d y=%d "
+			    "w=%d h=%d", n, m->sx, m->sy, m->sw, m->sh);
+			ms->g.x = m->sx;
+			ms->g.y = m->sy;
+			ms->g.w = m->sw;
+			ms->g.h = m->sh;
+		}
+	}
+}
+
+static void
+untitle(Window w) {
+	int i;
+
+	for (i = 0; i < ntitled; i++)
+		if (titled[i] == w)
+			titled[i] = None;
+}
+
+/* Compares the sorted window lists of now and last time. */
+static void
+diffclients(Conn * to) {
+	static Window *wins;
+	static int size;
+	Client *c;
+	int i, j, n;
+
+	if (to) {
+		for (c = clients; c; c = c->next)
+			event(to, IpcClients, "event add window=0x%lx name=%s",
+			    c->win, c->cold->name);
+		return;
+	}
+	for (n = 0, c = clients; c; c = c->next, n++) {
+		growwindows(&wins, &size, n + 1);
+		wins[n] = c->win;
+	}
+	qsort(wins, n, sizeof(Window), cmpwindow);
+	for (i = j = 0; i < n || j < nlastclients;) {
+		if (j == nlastclients || (i < n && wins[i] < lastclients[j])) {
+			if ((c = getclient(wins[i], clients, ClientWindow)))
+				event(NULL, IpcClients, "event add window=0x%lx name=%s",
+				    c->win, c->cold->name);
+			untitle(wins[i++]);
+		} else if (i == n || wins[i] > lastclients[j])
+			event(NULL, IpcClients, "event remove window=0x%lx",
+			    lastclients[j++]);
+		else
+			i++, j++;
+	}
+	growwindows(&lastclients, &lastclientsize, n);
+	memcpy(lastclients, wins, n * sizeof(Window));
+	nlastclients = n;
+}
+
+static void
+difftitles(void) {
+	Client *c;
+	int i;
+
+	for (i = 0; i < ntitled; i++)
+		if (titled[i] && (c = getclient(titled[i], clients, ClientWindow)))
+			event(NULL, IpcTitle, "event title window=0x%lx name=%s",
+			    c->win, c->cold->name);
+	ntitled = 0;
+}
+
+/* Publishes what changed since the last call.  Without subscribers the
+ * comparison is skipped unless forced, which leaves the saved state
+ * stale until the next subscribe. */
+static void
+publish(Bool force) {
+	int i;
+
+	if (!dirty || (!nsubscribers && !force))
+		return;
+	if (dirty & IpcFocus)
+		difffocus(NULL);
+	if (dirty & (IpcView | IpcLayout | IpcMonitors))
+		diffmonitors(NULL);
+	if (dirty & IpcClients)
+		diffclients(NULL);
+	if (dirty & IpcTitle)
+		difftitles();
+	dirty = 0;
+	ntitled = 0;
+	for (i = 0; i < nconns; i++)
+		if (conns[i].pending) {
+			append(&conns[i], "event end\n", 10);
+			conns[i].pending = False;
+		}
+}
+
+/* subscribe [focus|view|layout|clients|title|monitors ...]; answers with
+ * the current state */
+static void
+ipcsubscribe(const char *arg) {
+	unsigned int i, what = 0;
+	const char *p;
+	int len;
+
+	for (p = arg; p && *p; p += len) {
+		for (; isspace((unsigned char) *p); p++);
+		for (len = 0; p[len] && !isspace((unsigned char) p[len]); len++);
+		if (!len)
+			break;
+		for (i = 0; i < LENGTH(ipcevents); i++)
+			if (strlen(ipcevents[i]) == (size_t) len
+			    && !strncmp(p, ipcevents[i], len))
+				break;
+		if (i == LENGTH(ipcevents)) {
+			reply("error unknown event %.*s", len, p);
+			return;
+		}
+		what |= (1 << i);
+	}
+	if (!what)
+		what = IpcAll;
+	/* bring the saved state up to date before adding a subscriber */
+	dirty = IpcAll;
+	publish(True);
+	if (!cur->subscribed)
+		nsubscribers++;
+	cur->subscribed = what;
+	difffocus(cur);
+	diffmonitors(cur);
+	diffclients(cur);
+	reply("ok");
+}
+
+/* Tag arguments may be given by name or by index. */
+static const char *
+argtag(const char *arg) {
+	unsigned int i;
+	char *end;
+
+	if (!arg)
+		return NULL;
+	for (i = 0; i < ntags; i++)
+		if (!strcmp(arg, tags[i]))
+			return tags[i];
+	i = strtoul(arg, &end, 10);
+	return (end != arg && !*end && i < ntags) ? tags[i] : NULL;
+}
+
+static void
+command(char *line) {
+	char *name, *arg;
+	unsigned int i;
+	StatsMark sm;
+	KeyItem *ki;
+	Bool bytag;
+
+	for (name = line; isspace((unsigned char) *name); name++);
+	for (arg = name; *arg && !isspace((unsigned char) *arg); arg++);
+	if (*arg)
+		for (*arg++ = '\0'; isspace((unsigned char) *arg); arg++);
+	if (!*arg)
+		arg = NULL;
+	if (!*name) {
+		reply("error empty command");
+		return;
+	}
+	if (!curmonitor()) {
+		reply("error no monitor");
+		return;
+	}
+	for (i = 0; i < LENGTH(ipccmds); i++)
+		if (!strcmp(name, ipccmds[i].name)) {
+			ipccmds[i].func(arg);
+			return;
+		}
+	if (!(ki = getkeyitem(name, &bytag))) {
+		reply("error unknown command %s", name);
+		return;
+	}
+	if (bytag && !(arg = (char *) argtag(arg))) {
+		reply("error no such tag");
+		return;
+	}
+	statsbegin(&sm);
+	ki->action(arg);
+	statsaction(ki->name, &sm);
+	reply("ok");
+}
+
+static void
+dropconn(Conn * c) {
+	if (c->subscribed)
+		nsubscribers--;
+	close(c->fd);
+	free(c->out);
+	*c = conns[--nconns];
+	memset(&conns[nconns], 0, sizeof(Conn));
+}
+
+/* Returns False if the connection had to be dropped. */
+static Bool
+flushconn(Conn * c) {
+	ssize_t n;
+
+	while (c->outlen) {
+		n = send(c->fd, c->out, c->outlen, MSG_NOSIGNAL);
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (n <= 0)
+			return False;
+		memmove(c->out, c->out + n, c->outlen - n);
+		c->outlen -= n;
+	}
+	return c->outlen < MAXOUT;
+}
+
+static Bool
+readconn(Conn * c) {
+	char *nl, *line;
+	ssize_t n;
+
+	n = read(c->fd, c->in + c->inlen, sizeof(c->in) - c->inlen);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return True;
+	if (n <= 0)
+		return False;
+	c->inlen += n;
+	cur = c;
+	for (line = c->in; (nl = memchr(line, '\n', c->in + c->inlen - line));
+	    line = nl + 1) {
+		*nl = '\0';
+		if (c->discarding)
+			c->discarding = False;	/* the tail of it */
+		else
+			command(line);
+	}
+	c->inlen -= line - c->in;
+	memmove(c->in, line, c->inlen);
+	/* The rest of an overlong line is not a command: drop it up to
+	 * its newline. */
+	if (c->inlen == sizeof(c->in)) {
+		if (!c->discarding)
+			reply("error line too long");
+		c->discarding = True;
+		c->inlen = 0;
+	}
+	return True;
+}
+
+/* Actions include spawn, so only our own user may connect. */
+static Bool
+peerok(int fd) {
+#ifdef SO_PEERCRED
+	struct ucred cr;
+	socklen_t len = sizeof(cr);
+
+	return !getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cr, &len)
+	    && cr.uid == getuid();
+#else
+	uid_t uid;
+	gid_t gid;
+
+	return !getpeereid(fd, &uid, &gid) && uid == getuid();
+#endif
+}
+
+static void
+acceptconn(void) {
+	int fd;
+
+	if ((fd = accept(sock, NULL, NULL)) < 0)
+		return;
+	if (nconns == MAXCONNS || !peerok(fd)) {
+		close(fd);
+		return;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	conns[nconns++].fd = fd;
+}
+
+/* Adds the socket and its connections to the sets for select(), returns
+ * the highest descriptor. */
+int
+ipcfds(fd_set * rd, fd_set * wr, int maxfd) {
+	int i;
+
+	if (sock < 0)
+		return maxfd;
+	FD_SET(sock, rd);
+	maxfd = max(maxfd, sock);
+	for (i = 0; i < nconns; i++) {
+		FD_SET(conns[i].fd, rd);
+		if (conns[i].outlen)
+			FD_SET(conns[i].fd, wr);
+		maxfd = max(maxfd, conns[i].fd);
+	}
+	return maxfd;
+}
+
+void
+ipchandle(fd_set * rd, fd_set * wr) {
+	Bool ran = False;
+	int i;
+
+	if (sock < 0)
+		return;
+	for (i = nconns - 1; i >= 0; i--) {
+		if (FD_ISSET(conns[i].fd, rd)) {
+			ran = True;
+			if (!readconn(&conns[i])) {
+				dropconn(&conns[i]);
+				continue;
+			}
+		}
+		if ((conns[i].outlen || FD_ISSET(conns[i].fd, wr))
+		    && !flushconn(&conns[i]))
+			dropconn(&conns[i]);
+	}
+	if (FD_ISSET(sock, rd))
+		acceptconn();
+	if (ran)
+		XFlush(dpy);
+}
+
+/* Notes that something subscribers may care about changed; c is the
+ * client whose title changed for IpcTitle. */
+void
+ipcnotify(unsigned int what, Client * c) {
+	int i;
+
+	snapshotnotify();
+	if (!nsubscribers)
+		return;
+	dirty |= what;
+	if (c && (what & IpcTitle)) {
+		for (i = 0; i < ntitled && titled[i] != c->win; i++);
+		if (i < ntitled)
+			return;
+		growwindows(&titled, &titledsize, ntitled + 1);
+		titled[ntitled++] = c->win;
+	}
+}
+
+/* Sends the changes of this event loop iteration to the subscribers. */
+void
+ipcflush(void) {
+	int i;
+
+	if (!dirty)
+		return;
+	publish(False);
+	for (i = nconns - 1; i >= 0; i--)
+		if (conns[i].outlen && !flushconn(&conns[i]))
+			dropconn(&conns[i]);
+}
+
+/* Makes dir unless it exists, and checks that only we can get into it,
+ * so nobody else can put a socket of theirs in our place. */
+static Bool
+privatedir(const char *dir) {
+	struct stat st;
+
+	if (mkdir(dir, 0700) < 0 && errno != EEXIST)
+		return False;
+	if (lstat(dir, &st) < 0)
+		return False;
+	if (!S_ISDIR(st.st_mode) || st.st_uid != getuid()
+	    || (st.st_mode & 077)) {
+		errno = EPERM;
+		return False;
+	}
+	return True;
+}
+
+void
+ipcinit(void) {
+	const char *path, *dir;
+	char priv[64];
+	mode_t mask;
+	int r;
+
+	path = getresource("socket", NULL);
+	addr.sun_family = AF_UNIX;
+	if (path)
+		snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	else if ((dir = getenv("XDG_RUNTIME_DIR")))
+		snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/echinus-%u%s",
+		    dir, (unsigned int) getuid(), DisplayString(dpy));
+	else {
+		/* /tmp is shared, use a directory of our own in it */
+		snprintf(priv, sizeof(priv), "/tmp/echinus-%u",
+		    (unsigned int) getuid());
+		if (!privatedir(priv)) {
+			fprintf(stderr, "echinus: cannot use %s: %s\n", priv,
+			    strerror(errno));
+			return;
+		}
+		snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/echinus%s",
+		    priv, DisplayString(dpy));
+	}
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		perror("echinus: socket");
+		return;
+	}
+	unlink(addr.sun_path);
+	mask = umask(077);
+	r = bind(sock, (struct sockaddr *) &addr, sizeof(addr));
+	umask(mask);
+	if (r < 0 || chmod(addr.sun_path, 0600) < 0
+	    || listen(sock, MAXCONNS) < 0) {
+		fprintf(stderr, "echinus: cannot listen on %s: %s\n",
+		    addr.sun_path, strerror(errno));
+		close(sock);
+		sock = -1;
+		return;
+	}
+	fcntl(sock, F_SETFD, FD_CLOEXEC);
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	setenv("ECHINUS_SOCKET", addr.sun_path, 1);
+}
+
+void
+ipcclose(void) {
+	while (nconns)
+		dropconn(&conns[0]);
+	if (sock < 0)
+		return;
+	close(sock);
+	unlink(addr.sun_path);
+	sock = -1;
+}
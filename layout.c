@@ -0,0 +1,224 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains the tiling layouts
+ *
+ *  Layout functions only compute geometry: they get the visible tiled
+ *  clients of a monitor in client list order and fill in one Geometry per
+ *  client.  Applying the result to the server is left to arrangemon(), so
+ *  nothing in here talks to X.
+ */
+#include <regex.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+#include "config.h"
+
+static void bstack(Monitor * m, View * v, Client ** cl, Geometry * g, int n);
+static void centered(Monitor * m, View * v, Client ** cl, Geometry * g, int n);
+static void grid(Monitor * m, View * v, Client ** cl, Geometry * g, int n);
+static void monocle(Monitor * m, View * v, Client ** cl, Geometry * g, int n);
+static void tile(Monitor * m, View * v, Client ** cl, Geometry * g, int n);
+
+/* new layouts go here, the table is terminated by a '\0' symbol */
+Layout layouts[] = {
+	/* function	symbol	features */
+	{  NULL,	'i',	OVERLAP },
+	{  tile,	't',	MWFACT | NMASTER | ZOOM },
+	{  bstack,	'b',	MWFACT | ZOOM },
+	{  monocle,	'm',	OCCLUDE },
+	{  NULL,	'f',	OVERLAP },
+	{  grid,	'g',	ZOOM },
+	{  centered,	'c',	MWFACT | NMASTER | ZOOM },
+	{  NULL,	'\0',	0 },
+};
+
+Layout *
+getlayout(char symbol) {
+	Layout *l;
+
+	for (l = layouts; l->symbol != '\0'; l++)
+		if (l->symbol == symbol)
+			return l;
+	return NULL;
+}
+
+/* Stacks n clients from top to bottom in the given area, splitting its
+ * height evenly; the last one takes the remainder. */
+static void
+column(Client ** cl, Geometry * g, int n, int x, int y, int w, int h) {
+	int i, ch, ny;
+
+	if (n <= 0)
+		return;
+	ch = h / n;
+	for (i = 0, ny = y; i < n; i++, ny += ch) {
+		g[i].x = x + options.gap;
+		g[i].y = ny + options.gap;
+		g[i].w = w - 2 * cl[i]->border - 2 * options.gap;
+		g[i].h = ((i + 1 == n) ? y + h - ny : ch) - 2 * cl[i]->border
+		    - 2 * options.gap;
+	}
+}
+
+static void
+bstack(Monitor * m, View * v, Client ** cl, Geometry * g, int n) {
+	int i, nx, ny, nw, nh, mh, tw;
+	Client *c;
+
+	mh = (n == 1) ? m->wah : v->mwfact * m->wah;
+	tw = (n > 1) ? m->waw / (n - 1) : 0;
+
+	nx = m->wax;
+	ny = m->way;
+	nw = nh = 0;
+	for (i = 0; i < n; i++) {
+		c = cl[i];
+		if (i == 0) {
+			nh = mh - 2 * c->border;
+			nw = m->waw - 2 * c->border;
+			nx = m->wax;
+		} else {
+			if (i == 1) {
+				nx = m->wax;
+				ny += g[0].h + c->border;
+				nh = (m->way + m->wah) - ny - 2 * c->border;
+			}
+			if (i + 1 == n)
+				nw = (m->wax + m->waw) - nx - 2 * c->border;
+			else
+				nw = tw - c->border;
+		}
+		g[i].x = nx;
+		g[i].y = ny;
+		g[i].w = nw;
+		g[i].h = nh;
+		if (n > 1 && tw != m->waw)
+			nx = g[i].x + g[i].w + c->border;
+	}
+}
+
+static void
+monocle(Monitor * m, View * v, Client ** cl, Geometry * g, int n) {
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (v->barpos != StrutsOn) {
+			g[i].x = m->wax - cl[i]->border;
+			g[i].y = m->way - cl[i]->border;
+			g[i].w = m->waw;
+			g[i].h = m->wah;
+		} else {
+			g[i].x = m->wax;
+			g[i].y = m->way;
+			g[i].w = m->waw - 2 * cl[i]->border;
+			g[i].h = m->wah - 2 * cl[i]->border;
+		}
+	}
+}
+
+static void
+tile(Monitor * m, View * v, Client ** cl, Geometry * g, int n) {
+	int nx, ny, nw, nh, mw, mh, th, gap;
+	int i, nmaster;
+	Client *c;
+
+	nmaster = v->nmaster;
+	/* window geoms */
+	mh = (n <= nmaster) ? m->wah / (n > 0 ? n : 1) :
+	    m->wah / (nmaster ? nmaster : 1);
+	mw = (n <= nmaster) ? m->waw : v->mwfact * m->waw;
+	th = (n > nmaster) ? m->wah / (n - nmaster) : 0;
+	if (n > nmaster && th < (int) style.titleheight)
+		th = m->wah;
+
+	nx = m->wax;
+	ny = m->way;
+	nw = nh = 0;
+	gap = 0;
+	for (i = 0; i < n; i++) {
+		c = cl[i];
+		if (i < nmaster) {	/* master */
+			ny = m->way + i * (mh - c->border);
+			nw = mw - 2 * c->border;
+			nh = mh;
+			if (i + 1 == (n < nmaster ? n : nmaster))	/* remainder */
+				nh = m->way + m->wah - ny;
+			nh -= 2 * c->border;
+			/* gaps */
+			ny = ny + options.gap;
+			nx = nx + options.gap;
+			nh = nh - options.gap * 2;
+			nw = nw - options.gap * 2;
+		} else {	/* tile window */
+			if (i == nmaster) {
+				ny = m->way;
+				nx += g[0].w + cl[0]->border;
+				nw = m->waw - nx - 2 * c->border + m->wax;
+			} else
+				ny -= c->border;
+			if (i + 1 == n)	/* remainder */
+				nh = (m->way + m->wah) - ny - 2 * c->border;
+			else
+				nh = th - 2 * c->border;
+			/* gaps */
+			if (gap == 0) {
+				gap = 1;
+				nx = nx + options.gap;
+				nw = nw - options.gap * 2;
+			}
+			ny = ny + options.gap;
+			nh = nh - options.gap * 2;
+		}
+		g[i].x = nx;
+		g[i].y = ny;
+		g[i].w = nw;
+		g[i].h = nh;
+		if (n > nmaster && th != m->wah)
+			ny = g[i].y + g[i].h + 2 * c->border;
+	}
+}
+
+static void
+centered(Monitor * m, View * v, Client ** cl, Geometry * g, int n) {
+	int nmaster, nm, ns, nl, mw, mx, lw, rw;
+
+	nmaster = v->nmaster;
+	nm = min(n, nmaster);
+	ns = n - nm;
+	mw = ns ? v->mwfact * m->waw : m->waw;
+	if (ns > 1) {
+		/* master in the middle, stack split to both sides */
+		lw = (m->waw - mw) / 2;
+		rw = m->waw - mw - lw;
+		mx = m->wax + lw;
+	} else {
+		lw = 0;
+		rw = m->waw - mw;
+		mx = m->wax;
+	}
+	column(cl, g, nm, mx, m->way, mw, m->wah);
+	if (!ns)
+		return;
+	/* first half of the stack goes right (it gets the odd one out),
+	 * the rest goes left */
+	nl = ns / 2;
+	column(cl + nm, g + nm, ns - nl, mx + mw, m->way, rw, m->wah);
+	column(cl + nm + ns - nl, g + nm + ns - nl, nl, m->wax, m->way, lw,
+	    m->wah);
+}
+
+static void
+grid(Monitor * m, View * v, Client ** cl, Geometry * g, int n) {
+	int i, j, cols, rows, cx, cw;
+
+	for (cols = 1; cols * cols < n; cols++);
+	for (i = j = 0, cx = m->wax; j < cols; j++, i += rows, cx += cw) {
+		/* the first n % cols columns get one client more */
+		rows = n / cols + (j < n % cols ? 1 : 0);
+		cw = (j + 1 == cols) ? m->wax + m->waw - cx : m->waw / cols;
+		column(cl + i, g + i, rows, cx, m->way, cw, m->wah);
+	}
+}
@@ -12,11 +12,6 @@
 #include "echinus.h"
 #include "config.h"
 
-typedef struct {
-	const char *name;
-	void (*action) (const char *arg);
-} KeyItem;
-
 static KeyItem KeyItems[] = {
 	{ "togglestruts",	togglestruts	},
 	{ "focusicon",		focusicon	},
@@ -45,6 +40,7 @@ static KeyItem KeyItems[] = {
 	{ "resizeincy", 	moveresizekb	},
 	{ "togglemonitor", 	togglemonitor	},
 	{ "togglefill", 	togglefill	},
+	{ "switcher", 		switcher	},
 };
 
 static KeyItem KeyItemsByTag[] = {
@@ -55,6 +51,33 @@ static KeyItem KeyItemsByTag[] = {
 	{ "toggletag", 		toggletag	},
 };
 
+/* actions that are bound differently but can be called by name */
+static KeyItem ExtraItems[] = {
+	{ "setlayout",		setlayout	},
+	{ "setmwfact",		setmwfact	},
+	{ "spawn",		spawn		},
+};
+
+/* Looks up an action by name for ipc.c.  *bytag is set if the action
+ * takes a tag name as its argument. */
+KeyItem *
+getkeyitem(const char *name, Bool *bytag) {
+	unsigned int i;
+
+	*bytag = False;
+	for (i = 0; i < LENGTH(KeyItems); i++)
+		if (!strcmp(KeyItems[i].name, name))
+			return &KeyItems[i];
+	for (i = 0; i < LENGTH(ExtraItems); i++)
+		if (!strcmp(ExtraItems[i].name, name))
+			return &ExtraItems[i];
+	*bytag = True;
+	for (i = 0; i < LENGTH(KeyItemsByTag); i++)
+		if (!strcmp(KeyItemsByTag[i].name, name))
+			return &KeyItemsByTag[i];
+	return NULL;
+}
+
 static void
 parsekey(const char *s, Key *k) {
 	int l = strlen(s);
@@ -128,9 +151,38 @@ initmodkey() {
 	}
 }
 
+/* Per tag functions for tags [ntagkeys, n), bound by index so that they
+ * survive tags being renamed at runtime.  initkeys() reads the first 64;
+ * settags() reads the rest when tags are added beyond that. */
+void
+inittagkeys(unsigned int n) {
+	static unsigned int ntagkeys;
+	unsigned int i, j;
+	const char *tmp;
+	char t[64];
+
+	for (i = ntagkeys; i < n; i++) {
+		for (j = 0; j < LENGTH(KeyItemsByTag); j++) {
+			snprintf(t, sizeof(t), "%s%d", KeyItemsByTag[j].name, i);
+			tmp = getresource(t, NULL);
+			if (!tmp)
+				continue;
+			keys = realloc(keys, sizeof(Key *) * (nkeys + 1));
+			keys[nkeys] = malloc(sizeof(Key));
+			keys[nkeys]->func = KeyItemsByTag[j].action;
+			keys[nkeys]->arg = NULL;
+			keys[nkeys]->tag = i;
+			keys[nkeys]->name = KeyItemsByTag[j].name;
+			parsekey(tmp, keys[nkeys]);
+			nkeys++;
+		}
+	}
+	ntagkeys = max(ntagkeys, n);
+}
+
 int
 initkeys() {
-	unsigned int i, j;
+	unsigned int i;
 	const char *tmp;
 	char t[64];
 
@@ -144,24 +196,12 @@ initkeys() {
 		keys[nkeys] = malloc(sizeof(Key));
 		keys[nkeys]->func = KeyItems[i].action;
 		keys[nkeys]->arg = NULL;
+		keys[nkeys]->tag = -1;
+		keys[nkeys]->name = KeyItems[i].name;
 		parsekey(tmp, keys[nkeys]);
 		nkeys++;
 	}
-	/* per tag functions */
-	for (j = 0; j < LENGTH(KeyItemsByTag); j++) {
-		for (i = 0; i < ntags; i++) {
-			snprintf(t, sizeof(t), "%s%d", KeyItemsByTag[j].name, i);
-			tmp = getresource(t, NULL);
-			if (!tmp)
-				continue;
-			keys = realloc(keys, sizeof(Key *) * (nkeys + 1));
-			keys[nkeys] = malloc(sizeof(Key));
-			keys[nkeys]->func = KeyItemsByTag[j].action;
-			keys[nkeys]->arg = tags[i];
-			parsekey(tmp, keys[nkeys]);
-			nkeys++;
-		}
-	}
+	inittagkeys(max(ntags, 64));
 	/* layout setting */
 	for (i = 0; layouts[i].symbol != '\0'; i++) {
 		snprintf(t, sizeof(t), "setlayout%c", layouts[i].symbol);
@@ -172,6 +212,8 @@ initkeys() {
 		keys[nkeys] = malloc(sizeof(Key));
 		keys[nkeys]->func = setlayout;
 		keys[nkeys]->arg = &layouts[i].symbol;
+		keys[nkeys]->tag = -1;
+		keys[nkeys]->name = "setlayout";
 		parsekey(tmp, keys[nkeys]);
 		nkeys++;
 	}
@@ -185,6 +227,8 @@ initkeys() {
 		keys[nkeys] = malloc(sizeof(Key));
 		keys[nkeys]->func = spawn;
 		keys[nkeys]->arg = NULL;
+		keys[nkeys]->tag = -1;
+		keys[nkeys]->name = "spawn";
 		parsekey(tmp, keys[nkeys]);
 		nkeys++;
 	}
@@ -195,7 +239,11 @@ static void
 parserule(const char *s, Rule *r) {
 	r->prop = emallocz(128);
 	r->tags = emallocz(64);
-	sscanf(s, "%s %s %d %d", r->prop, r->tags, &r->isfloating, &r->hastitle);
+	r->opacity = 1.0;
+	sscanf(s, "%s %s %d %d %lf", r->prop, r->tags, &r->isfloating,
+	    &r->hastitle, &r->opacity);
+	if (r->opacity < 0.0 || r->opacity > 1.0)
+		r->opacity = 1.0;
 }
 
 static void
@@ -0,0 +1,69 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains the client allocator
+ *
+ *  Kept apart from echinus.c so that tests/walk measures the very layout
+ *  echinus uses.
+ */
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+
+#define CLIENTSLAB	32	/* clients per pool slab */
+#define SLOTSIZE	(sizeof(Client) + pooltags * sizeof(Bool))
+
+static Client *freeclients;	/* linked through next */
+unsigned int pooltags;		/* tags each pool slot has room for */
+
+/* Clients come from slabs of CLIENTSLAB slots with room for their tags
+ * right behind them, so windows that come and go quickly cost no malloc().
+ * Each slot is paired for good with a ClientCold from a parallel slab.
+ * Slabs are never given back.  With more tags than a slot holds the tags
+ * go to the heap. */
+Client *
+allocclient(void) {
+	Client *c;
+	ClientCold *cold;
+	char *slab;
+	unsigned int i;
+
+	if (!pooltags)
+		pooltags = (ntags + 15) & ~15;
+	if (!freeclients) {
+		slab = emallocz(CLIENTSLAB * SLOTSIZE);
+		cold = emallocz(CLIENTSLAB * sizeof(ClientCold));
+		for (i = 0; i < CLIENTSLAB; i++) {
+			c = (Client *) (slab + i * SLOTSIZE);
+			c->cold = &cold[i];
+			c->next = freeclients;
+			freeclients = c;
+		}
+	}
+	c = freeclients;
+	freeclients = c->next;
+	cold = c->cold;
+	memset(c, 0, SLOTSIZE);
+	memset(cold, 0, sizeof(ClientCold));
+	cold->wmstate = -1;	/* whatever the window had before */
+	cold->opacity = cold->shownopacity = OPAQUE;
+	c->cold = cold;
+	c->tags = ntags <= pooltags ? SLOTTAGS(c) : emallocz(ntags * sizeof(Bool));
+	return c;
+}
+
+/* Puts c back into the pool, see allocclient(). */
+void
+freeclient(Client * c) {
+	/* bastards share their monitor's seltags */
+	if (!c->isbastard && c->tags != SLOTTAGS(c))
+		free(c->tags);
+	free(c->cold->name);
+	free(c->cold->class);
+	free(c->cold->skey);
+	c->next = freeclients;
+	freeclients = c;
+}
@@ -0,0 +1,209 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains the shared memory state snapshot
+ *
+ *  The layout is in snapshot.h.  snapshotupdate() is called by run()
+ *  right before it waits for the next events, so the snapshot changes
+ *  once per batch and never reflects a half handled event.  It only
+ *  writes when snapshotnotify() was called since, so wakeups that change
+ *  nothing don't make readers retry.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <regex.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+#include "config.h"
+#include "snapshot.h"
+
+#define ALIGN(_n)	(((_n) + 7) & ~7)
+
+static char name[128];
+static int fd = -1;
+static unsigned char *map;
+static size_t mapsize;
+static Bool dirty = True;
+
+/* Grows the object to at least size bytes.  Readers notice through
+ * SnapshotHeader.size and remap. */
+static Bool
+growmap(size_t size) {
+	unsigned char *m;
+	long page = sysconf(_SC_PAGESIZE);
+
+	size = max(size, mapsize * 2);
+	size = (size + page - 1) / page * page;
+	if (ftruncate(fd, size) < 0)
+		return False;
+	if ((m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		return False;
+	if (map)
+		munmap(map, mapsize);
+	map = m;
+	mapsize = size;
+	return True;
+}
+
+static void
+tagstr(unsigned char *dst, Bool *tags) {
+	unsigned int i;
+
+	for (i = 0; i < ntags; i++)
+		dst[i] = tags[i] ? 1 : 0;
+}
+
+void
+snapshotupdate(void) {
+	SnapshotHeader *hdr;
+	SnapshotMonitor *sm;
+	SnapshotTag *st;
+	SnapshotClient *sc;
+	Monitor *m;
+	Client *c;
+	size_t size, off;
+	unsigned int i, nmon, ncl;
+
+	if (fd < 0 || !dirty)
+		return;
+	dirty = False;
+	for (nmon = 0, m = monitors; m; m = m->next, nmon++);
+	for (ncl = 0, c = clients; c; c = c->next, ncl++);
+	size = ALIGN(sizeof(SnapshotHeader))
+	    + nmon * ALIGN(sizeof(SnapshotMonitor) + ntags)
+	    + ntags * ALIGN(sizeof(SnapshotTag))
+	    + ncl * ALIGN(sizeof(SnapshotClient) + ntags);
+	/* growing leaves the contents alone, so it is done before seq goes
+	 * odd: a failure must not leave readers waiting for it to be even */
+	if (size > mapsize && !growmap(size)) {
+		fprintf(stderr, "echinus: cannot grow snapshot: %s\n",
+		    strerror(errno));
+		snapshotclose();
+		return;
+	}
+	hdr = (SnapshotHeader *) map;
+	hdr->seq++;
+	__sync_synchronize();
+	hdr->size = mapsize;
+	hdr->nmonitors = nmon;
+	hdr->ntags = ntags;
+	hdr->nclients = ncl;
+	hdr->focus = sel ? sel->win : 0;
+	off = ALIGN(sizeof(SnapshotHeader));
+
+	hdr->monitors = off;
+	for (m = monitors; m; m = m->next) {
+		sm = (SnapshotMonitor *) (map + off);
+		sm->x = m->sx;
+		sm->y = m->sy;
+		sm->w = m->sw;
+		sm->h = m->sh;
+		sm->wax = m->wax;
+		sm->way = m->way;
+		sm->waw = m->waw;
+		sm->wah = m->wah;
+		sm->curtag = m->curtag;
+		sm->seltags = off + sizeof(SnapshotMonitor);
+		tagstr(map + sm->seltags, m->seltags);
+		off += ALIGN(sizeof(SnapshotMonitor) + ntags);
+	}
+
+	hdr->tags = off;
+	st = (SnapshotTag *) (map + off);
+	for (i = 0; i < ntags; i++) {
+		memset(&st[i], 0, sizeof(SnapshotTag));
+		snprintf(st[i].name, sizeof(st[i].name), "%s", tags[i]);
+		st[i].layout = views[i].layout->symbol;
+		st[i].nmaster = views[i].nmaster;
+		st[i].mwfact = views[i].mwfact;
+	}
+	off += ntags * ALIGN(sizeof(SnapshotTag));
+
+	hdr->clients = off;
+	for (c = clients; c; c = c->next) {
+		sc = (SnapshotClient *) (map + off);
+		sc->window = c->win;
+		sc->frame = c->frame;
+		sc->x = c->x;
+		sc->y = c->y;
+		sc->w = c->w;
+		sc->h = c->h;
+		sc->border = c->border;
+		sc->flags = (c->isfloating ? SnapFloating : 0)
+		    | (c->isicon ? SnapIcon : 0) | (c == sel ? SnapFocused : 0)
+		    | (c->isbastard ? SnapBastard : 0) | (c->ismax ? SnapMax : 0)
+		    | (isvisible(c, NULL) ? SnapVisible : 0);
+		sc->tags = off + sizeof(SnapshotClient);
+		tagstr(map + sc->tags, c->tags);
+		for (i = 0; i < ntags; i++)
+			if (c->tags[i] && !c->isbastard)
+				st[i].nclients++;
+		snprintf(sc->name, sizeof(sc->name), "%s", c->cold->name);
+		snprintf(sc->class, sizeof(sc->class), "%s", c->cold->class ? c->cold->class : "");
+		off += ALIGN(sizeof(SnapshotClient) + ntags);
+	}
+	__sync_synchronize();
+	hdr->seq++;
+}
+
+/* Notes that there is something new to write.  ipcnotify() calls it for
+ * every change it is told about, moveresize() for geometry. */
+void
+snapshotnotify(void) {
+	dirty = True;
+}
+
+void
+snapshotinit(void) {
+	const char *res;
+	char *p;
+
+	if (!atoi(getresource("snapshot", "1")))
+		return;
+	snprintf(name, sizeof(name), "/echinus-%u%s", (unsigned int) getuid(),
+	    DisplayString(dpy));
+	for (p = name + 1; *p; p++)
+		if (*p == '/')
+			*p = '_';
+	if ((res = getresource("snapshot.name", NULL)))
+		snprintf(name, sizeof(name), "%s", res);
+	if ((fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0) {
+		fprintf(stderr, "echinus: cannot create snapshot %s: %s\n",
+		    name, strerror(errno));
+		return;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	if (!growmap(sizeof(SnapshotHeader))) {
+		fprintf(stderr, "echinus: cannot map snapshot: %s\n",
+		    strerror(errno));
+		snapshotclose();
+		return;
+	}
+	((SnapshotHeader *) map)->magic = SNAPSHOT_MAGIC;
+	((SnapshotHeader *) map)->version = SNAPSHOT_VERSION;
+	setenv("ECHINUS_SNAPSHOT", name, 1);
+}
+
+void
+snapshotclose(void) {
+	if (map)
+		munmap(map, mapsize);
+	map = NULL;
+	mapsize = 0;
+	if (fd < 0)
+		return;
+	close(fd);
+	shm_unlink(name);
+	fd = -1;
+}
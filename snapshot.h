@@ -0,0 +1,72 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file describes the shared memory state snapshot
+ *
+ *  echinus keeps a POSIX shared memory object (its name is exported to
+ *  children as ECHINUS_SNAPSHOT) up to date with the state of monitors,
+ *  tags and clients, rewritten after every batch of events.  Readers map
+ *  it read-only and never have to talk to the X server or to echinus.
+ *
+ *  The object starts with a SnapshotHeader; the arrays it points to are
+ *  given as byte offsets from the start of the mapping.  Writes are
+ *  guarded by a sequence counter, so a consistent copy is taken like this:
+ *
+ *	do {
+ *		while ((seq = hdr->seq) & 1)
+ *			;			(being written)
+ *		__sync_synchronize();
+ *		if (hdr->size > mapped)
+ *			remap the object with hdr->size bytes;
+ *		copy what you need;
+ *		__sync_synchronize();
+ *	} while (hdr->seq != seq);
+ *
+ *  Nothing read inside the loop may be trusted before the final check
+ *  passes.  Readers have to check magic and version first; the layout
+ *  only changes together with SNAPSHOT_VERSION.
+ */
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC		0x53484345	/* "ECHS" */
+#define SNAPSHOT_VERSION	1
+
+enum { SnapFloating = 1, SnapIcon = 2, SnapFocused = 4, SnapBastard = 8,
+	SnapMax = 16, SnapVisible = 32 };	/* SnapshotClient.flags */
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	volatile uint32_t seq;	/* odd while being written */
+	uint32_t size;		/* size of the object */
+	uint32_t nmonitors, ntags, nclients;
+	uint32_t monitors, tags, clients;	/* offsets of the arrays */
+	uint32_t focus;		/* window of the focused client, or 0 */
+} SnapshotHeader;
+
+typedef struct {
+	int32_t x, y, w, h;		/* screen area */
+	int32_t wax, way, waw, wah;	/* area left for clients */
+	uint32_t curtag;
+	uint32_t seltags;	/* offset of ntags bytes, 1 if viewed */
+} SnapshotMonitor;
+
+typedef struct {
+	char name[64];
+	char layout;		/* layout symbol */
+	char pad[3];
+	int32_t nmaster;
+	double mwfact;
+	uint32_t nclients;	/* clients tagged with it */
+	uint32_t pad2;
+} SnapshotTag;
+
+typedef struct {
+	uint32_t window, frame;
+	int32_t x, y, w, h;
+	uint32_t border;
+	uint32_t flags;		/* Snap* */
+	uint32_t tags;		/* offset of ntags bytes, 1 if tagged */
+	uint32_t pad;
+	char name[256];
+	char class[64];
+} SnapshotClient;
@@ -0,0 +1,218 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains the runtime statistics
+ *
+ *  Statistics are always collected.  For every X event type and every key
+ *  action they record how long handling took (as a log2 histogram in
+ *  microseconds), how many requests were issued and how many of those
+ *  waited for a reply.  Round trips are counted by the wrappers at the end
+ *  of echinus.h.  The clients that change their title, hints or geometry
+ *  most often are listed too.  SIGUSR1 dumps everything to stderr.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <regex.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+#include "config.h"
+
+#define NBUCKETS	24	/* 1us .. 8s */
+#define NOFFENDERS	5	/* clients listed by dumpoffenders() */
+
+typedef struct {
+	const char *name;
+	unsigned long count;
+	unsigned long long total, max;
+	unsigned long requests;
+	unsigned long roundtrips;
+	unsigned long bucket[NBUCKETS];
+} Histogram;
+
+unsigned long roundtrips[RtLast];
+
+static const char *rtnames[RtLast] = {
+	[RtSync] = "sync",
+	[RtQueryPointer] = "querypointer",
+	[RtGetProperty] = "getproperty",
+	[RtOther] = "other",
+};
+
+static Histogram events[LASTEvent] = {
+	[KeyPress] = { "KeyPress" },
+	[KeyRelease] = { "KeyRelease" },
+	[ButtonPress] = { "ButtonPress" },
+	[ButtonRelease] = { "ButtonRelease" },
+	[MotionNotify] = { "MotionNotify" },
+	[EnterNotify] = { "EnterNotify" },
+	[LeaveNotify] = { "LeaveNotify" },
+	[FocusIn] = { "FocusIn" },
+	[FocusOut] = { "FocusOut" },
+	[KeymapNotify] = { "KeymapNotify" },
+	[Expose] = { "Expose" },
+	[GraphicsExpose] = { "GraphicsExpose" },
+	[NoExpose] = { "NoExpose" },
+	[VisibilityNotify] = { "VisibilityNotify" },
+	[CreateNotify] = { "CreateNotify" },
+	[DestroyNotify] = { "DestroyNotify" },
+	[UnmapNotify] = { "UnmapNotify" },
+	[MapNotify] = { "MapNotify" },
+	[MapRequest] = { "MapRequest" },
+	[ReparentNotify] = { "ReparentNotify" },
+	[ConfigureNotify] = { "ConfigureNotify" },
+	[ConfigureRequest] = { "ConfigureRequest" },
+	[GravityNotify] = { "GravityNotify" },
+	[ResizeRequest] = { "ResizeRequest" },
+	[CirculateNotify] = { "CirculateNotify" },
+	[CirculateRequest] = { "CirculateRequest" },
+	[PropertyNotify] = { "PropertyNotify" },
+	[SelectionClear] = { "SelectionClear" },
+	[SelectionRequest] = { "SelectionRequest" },
+	[SelectionNotify] = { "SelectionNotify" },
+	[ColormapNotify] = { "ColormapNotify" },
+	[ClientMessage] = { "ClientMessage" },
+	[MappingNotify] = { "MappingNotify" },
+	[GenericEvent] = { "GenericEvent" },
+};
+
+static Histogram *actions;	/* one per distinct Key name */
+static unsigned int nactions;
+
+unsigned long long
+timeus(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned long
+totalroundtrips(void) {
+	unsigned long n = 0;
+	int i;
+
+	for (i = 0; i < RtLast; i++)
+		n += roundtrips[i];
+	return n;
+}
+
+void
+statsbegin(StatsMark * sm) {
+	sm->start = timeus();
+	sm->request = NextRequest(dpy);
+	sm->roundtrips = totalroundtrips();
+}
+
+static void
+record(Histogram * h, StatsMark * sm) {
+	unsigned long long t;
+	int b;
+
+	t = timeus() - sm->start;
+	for (b = 0; b < NBUCKETS - 1 && (t >> (b + 1)); b++);
+	h->bucket[b]++;
+	h->count++;
+	h->total += t;
+	if (t > h->max)
+		h->max = t;
+	h->requests += NextRequest(dpy) - sm->request;
+	h->roundtrips += totalroundtrips() - sm->roundtrips;
+}
+
+void
+statsevent(int type, StatsMark * sm) {
+	if (type < 0 || type >= LASTEvent)
+		return;
+	if (!events[type].name)
+		events[type].name = "Unknown";
+	record(&events[type], sm);
+}
+
+void
+statsaction(const char *name, StatsMark * sm) {
+	unsigned int i;
+
+	if (!name)
+		return;
+	for (i = 0; i < nactions && strcmp(actions[i].name, name); i++);
+	if (i == nactions) {
+		if (!(actions = realloc(actions, ++nactions * sizeof(Histogram))))
+			eprint("fatal: could not realloc() %u bytes\n",
+			    (unsigned int)(nactions * sizeof(Histogram)));
+		memset(&actions[i], 0, sizeof(Histogram));
+		actions[i].name = name;
+	}
+	record(&actions[i], sm);
+}
+
+static void
+dumphistogram(FILE * f, const char *kind, Histogram * h) {
+	int i, last;
+
+	if (!h->count)
+		return;
+	fprintf(f, "%s %s count=%lu total_us=%llu max_us=%llu requests=%lu "
+	    "roundtrips=%lu hist=", kind, h->name, h->count, h->total, h->max,
+	    h->requests, h->roundtrips);
+	for (last = NBUCKETS - 1; last > 0 && !h->bucket[last]; last--);
+	for (i = 0; i <= last; i++)
+		fprintf(f, "%s%lu", i ? "," : "", h->bucket[i]);
+	fputc('\n', f);
+}
+
+/* The clients that sent the most title, hint and configure changes, as
+ * counted by ratelimit(); throttled= is how many of those were held back. */
+static void
+dumpoffenders(FILE * f) {
+	Client *top[NOFFENDERS], *c;
+	unsigned long n[NOFFENDERS], t, throttled;
+	int i, k, ntop = 0;
+
+	for (c = clients; c; c = c->next) {
+		for (t = 0, k = 0; k < RateLast; k++)
+			t += c->cold->rate[k].total;
+		if (!t || (ntop == NOFFENDERS && t <= n[NOFFENDERS - 1]))
+			continue;
+		if (ntop < NOFFENDERS)
+			ntop++;
+		for (i = ntop - 1; i > 0 && n[i - 1] < t; i--) {
+			top[i] = top[i - 1];
+			n[i] = n[i - 1];
+		}
+		top[i] = c;
+		n[i] = t;
+	}
+	for (i = 0; i < ntop; i++) {
+		c = top[i];
+		for (throttled = 0, k = 0; k < RateLast; k++)
+			throttled += c->cold->rate[k].throttled;
+		fprintf(f, "client 0x%lx class=%s title=%lu hints=%lu configure=%lu "
+		    "throttled=%lu\n", c->win, c->cold->class ? c->cold->class : "",
+		    c->cold->rate[RateTitle].total, c->cold->rate[RateHints].total,
+		    c->cold->rate[RateConfigure].total, throttled);
+	}
+}
+
+/* One record per line, "kind name key=value ...".  hist= lists the count
+ * of events that took [2^i, 2^(i+1)) microseconds, starting at i = 0. */
+void
+statsdump(FILE * f) {
+	unsigned int i;
+
+	for (i = 0; i < LASTEvent; i++)
+		dumphistogram(f, "event", &events[i]);
+	for (i = 0; i < nactions; i++)
+		dumphistogram(f, "action", &actions[i]);
+	fprintf(f, "roundtrips");
+	for (i = 0; i < RtLast; i++)
+		fprintf(f, " %s=%lu", rtnames[i], roundtrips[i]);
+	fprintf(f, "\nrequests total=%lu\n", NextRequest(dpy) - 1);
+	fprintf(f, "resources colormaps=%d pooledframes=%d\n", ncmaps, nframes);
+	dumpoffenders(f);
+	fflush(f);
+}
@@ -0,0 +1,222 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains the window switcher
+ *
+ *  Every client carries a lowercase search key built from its class and
+ *  title, kept current by updatetitle().  Typing narrows the previous
+ *  result set instead of rescanning all clients, so filtering stays cheap
+ *  with hundreds of windows.  Nothing is focused or restacked until a
+ *  client is picked.
+ */
+#include <regex.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <X11/keysym.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+#include "config.h"
+
+#define SWITCHERMASK	(KeyPressMask | ExposureMask | SubstructureRedirectMask)
+
+static Client **matches;	/* current result set */
+static int nmatches, matchsize;
+
+void
+switcherindex(Client * c) {
+	size_t len;
+	char *p;
+
+	len = strlen(c->cold->name) + (c->cold->class ? strlen(c->cold->class) : 0) + 2;
+	free(c->cold->skey);
+	c->cold->skey = emallocz(len);
+	snprintf(c->cold->skey, len, "%s %s", c->cold->class ? c->cold->class : "", c->cold->name);
+	for (p = c->cold->skey; *p; p++)
+		*p = tolower((unsigned char) *p);
+}
+
+/* All space separated words of query have to be in the key. */
+static Bool
+matchclient(Client * c, const char *query) {
+	char word[256];
+	const char *p;
+	int len;
+
+	if (!c->cold->skey)
+		return False;
+	for (p = query; *p; p += len) {
+		for (; *p == ' '; p++);
+		for (len = 0; p[len] && p[len] != ' '; len++);
+		if (!len)
+			break;
+		snprintf(word, sizeof(word), "%.*s", len, p);
+		if (!strstr(c->cold->skey, word))
+			return False;
+	}
+	return True;
+}
+
+/* Narrows the current result set if the query only got longer, rescans
+ * the client list otherwise. */
+static void
+filter(const char *query, Bool narrow) {
+	Client *c;
+	int i, n;
+
+	if (narrow) {
+		for (i = n = 0; i < nmatches; i++)
+			if (matchclient(matches[i], query))
+				matches[n++] = matches[i];
+		nmatches = n;
+		return;
+	}
+	for (nmatches = 0, c = clients; c; c = c->next) {
+		if (c->isbastard || !matchclient(c, query))
+			continue;
+		if (nmatches == matchsize) {
+			matchsize = matchsize ? matchsize * 2 : 64;
+			if (!(matches = realloc(matches, matchsize * sizeof(Client *))))
+				eprint("fatal: could not realloc() %u bytes\n",
+				    (unsigned int)(matchsize * sizeof(Client *)));
+		}
+		matches[nmatches++] = c;
+	}
+}
+
+/* Makes c visible and focuses it. */
+void
+switchto(Client * c) {
+	Monitor *m;
+	unsigned int i;
+
+	if (!(m = curmonitor()))
+		return;
+	if (!isvisible(c, m)) {
+		for (i = 0; i < ntags && !c->tags[i]; i++);
+		if (i < ntags)
+			view(tags[i]);
+	}
+	if (c->isicon) {
+		c->isicon = False;
+		dirtytiled();
+		arrange(m);
+	}
+	focus(c);
+	restack(m);
+}
+
+void
+switcher(const char *arg) {
+	char query[256] = "", buf[32];
+	int len, cur, first, rows, maxrows, i;
+	unsigned int w, h;
+	Monitor *m;
+	Window win;
+	Pixmap pm;
+	XftDraw *xd;
+	XSetWindowAttributes wa;
+	XEvent ev;
+	KeySym ks;
+	Client *pick = NULL;
+
+	if (!(m = curmonitor()))
+		return;
+	h = style.titleheight;
+	w = m->waw / 2;
+	maxrows = m->wah / h - 1;
+	if (maxrows < 1)
+		return;
+	filter(query, False);
+	rows = min(nmatches, maxrows);
+	wa.override_redirect = True;
+	wa.background_pixel = style.color.norm[ColBG];
+	wa.border_pixel = style.color.sel[ColBorder];
+	wa.event_mask = ExposureMask;
+	win = XCreateWindow(dpy, root, m->wax + (m->waw - w) / 2,
+	    m->way + m->wah / 4, w, (rows + 1) * h, style.border,
+	    DefaultDepth(dpy, screen), CopyFromParent, DefaultVisual(dpy, screen),
+	    CWOverrideRedirect | CWBackPixel | CWBorderPixel | CWEventMask, &wa);
+	pm = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
+	xd = XftDrawCreate(dpy, pm, DefaultVisual(dpy, screen),
+	    DefaultColormap(dpy, screen));
+	XMapRaised(dpy, win);
+	if (XGrabKeyboard(dpy, root, True, GrabModeAsync, GrabModeAsync,
+		CurrentTime) != GrabSuccess)
+		goto out;
+	cur = first = 0;
+	for (;;) {
+		XMaskEvent(dpy, SWITCHERMASK, &ev);
+		switch (ev.type) {
+		case ConfigureRequest:
+		case MapRequest:
+			handler[ev.type] (&ev);
+			continue;
+		case Expose:
+			if (ev.xexpose.window != win) {
+				handler[ev.type] (&ev);
+				continue;
+			}
+			break;
+		case KeyPress:
+			len = XLookupString(&ev.xkey, buf, sizeof(buf), &ks, NULL);
+			switch (ks) {
+			case XK_Escape:
+				goto out;
+			case XK_Return:
+			case XK_KP_Enter:
+				if (nmatches)
+					pick = matches[cur];
+				goto out;
+			case XK_Up:
+			case XK_ISO_Left_Tab:
+				if (nmatches)
+					cur = (cur + nmatches - 1) % nmatches;
+				break;
+			case XK_Down:
+			case XK_Tab:
+				if (nmatches)
+					cur = (cur + 1) % nmatches;
+				break;
+			case XK_BackSpace:
+				if ((i = strlen(query))) {
+					query[i - 1] = '\0';
+					filter(query, False);
+					cur = first = 0;
+				}
+				break;
+			default:
+				if (len != 1 || !isprint((unsigned char) buf[0]) ||
+				    (i = strlen(query)) + 1 >= (int) sizeof(query))
+					continue;
+				query[i] = tolower((unsigned char) buf[0]);
+				query[i + 1] = '\0';
+				filter(query, True);
+				cur = first = 0;
+				break;
+			}
+			break;
+		}
+		/* keep the selection on screen */
+		if (cur < first)
+			first = cur;
+		else if (cur >= first + maxrows)
+			first = cur - maxrows + 1;
+		if (min(nmatches, maxrows) != rows) {
+			rows = min(nmatches, maxrows);
+			XResizeWindow(dpy, win, w, (rows + 1) * h);
+		}
+		drawswitcher(win, pm, xd, w, query, matches + first,
+		    rows, cur - first);
+	}
+      out:
+	XUngrabKeyboard(dpy, CurrentTime);
+	XftDrawDestroy(xd);
+	XFreePixmap(dpy, pm);
+	XDestroyWindow(dpy, win);
+	if (pick)
+		switchto(pick);
+}
@@ -0,0 +1,280 @@
+/*
+ * bench - measures echinus from the outside
+ *
+ * Starts the window manager given on the command line with n clients
+ * already mapped, then maps n more clients on each of the desktops 1, 2
+ * and 3 and drives it through EWMH client messages.  Every step waits for
+ * the property the window manager writes when it is done, so the numbers
+ * include the full round trip through the server.  Results go to stdout,
+ * one "metric key=value ..." record per line.
+ *
+ * The window manager has to be configured with at least five desktops,
+ * desktop 0 empty and desktops 1, 2 and 3 set to the layouts under test
+ * (see benchrc).
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/Xresource.h>
+
+#include "util.h"
+
+#define NLAYOUTS	3	/* desktops 1 .. 3 */
+#define SCANDESK	4	/* where the clients found at startup go */
+#define TIMEOUT		60	/* seconds per phase */
+
+int screen;
+Display *dpy;
+Window root;
+
+static Atom curdesk, activewin, windesk;
+static Window *wins[NLAYOUTS];
+static unsigned long long *samples;
+static int nclients = 10, rounds = 20;
+
+static void
+timeout(int sig) {
+	static const char msg[] = "bench: timed out waiting for the window manager\n";
+
+	write(2, msg, sizeof(msg) - 1);
+	_exit(EXIT_FAILURE);
+}
+
+static void
+msleep(long ms) {
+	struct timespec ts = { ms / 1000, ms % 1000 * 1000000 };
+
+	nanosleep(&ts, NULL);
+}
+
+static int
+cmpsample(const void *a, const void *b) {
+	unsigned long long x = *(unsigned long long *)a, y = *(unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Prints median, 95th percentile and maximum of n samples. */
+static void
+report(const char *metric, const char *keys, unsigned long long *s, int n) {
+	qsort(s, n, sizeof(s[0]), cmpsample);
+	printf("%s %sclients=%d samples=%d median_us=%llu p95_us=%llu max_us=%llu\n",
+			metric, keys, nclients, n, s[n / 2], s[n * 95 / 100], s[n - 1]);
+	fflush(stdout);
+}
+
+/* Waits until the root property atom holds value.  Checking the value
+ * instead of counting notifications keeps stale events from ending the
+ * wait early. */
+static void
+waitroot(Atom atom, long value) {
+	XEvent ev;
+
+	for(;;) {
+		XNextEvent(dpy, &ev);
+		if(ev.type == PropertyNotify && ev.xproperty.window == root
+		&& ev.xproperty.atom == atom && getcardinal(root, atom, -1) == value)
+			return;
+	}
+}
+
+/* Waits until the window manager has written _NET_WM_DESKTOP on n of our
+ * clients, which manage() does last. */
+static void
+waitmanaged(int n) {
+	XEvent ev;
+
+	while(n > 0) {
+		XNextEvent(dpy, &ev);
+		if(ev.type == PropertyNotify && ev.xproperty.atom == windesk
+		&& ev.xproperty.window != root)
+			n--;
+	}
+}
+
+static void
+view(long desk) {
+	if(getcardinal(root, curdesk, -1) == desk)
+		return;	/* there would be nothing to wait for */
+	sendmessage(root, curdesk, desk, CurrentTime);
+	XFlush(dpy);
+	waitroot(curdesk, desk);
+}
+
+static pid_t
+startwm(char **argv) {
+	Window w;
+	pid_t pid;
+	unsigned long long t;
+	int i;
+
+	/* these are already mapped when the window manager comes up */
+	for(i = 0; i < nclients; i++) {
+		w = mkclient("scan", SCANDESK);
+		XSelectInput(dpy, w, PropertyChangeMask);
+		XMapWindow(dpy, w);
+	}
+	XSync(dpy, False);
+	t = timeus();
+	if(!(pid = fork())) {
+		close(ConnectionNumber(dpy));
+		execvp(argv[0], argv);
+		eprint("bench: cannot exec %s\n", argv[0]);
+	}
+	if(pid < 0)
+		eprint("bench: cannot fork\n");
+	waitmanaged(nclients);
+	printf("startup clients=%d us=%llu\n", nclients, timeus() - t);
+	fflush(stdout);
+	return pid;
+}
+
+static void
+benchmap(void) {
+	unsigned long long t;
+	int i, j, n = 0;
+
+	for(j = 0; j < NLAYOUTS; j++) {
+		wins[j] = emallocz(nclients * sizeof(Window));
+		for(i = 0; i < nclients; i++) {
+			wins[j][i] = mkclient("bench", j + 1);
+			XSelectInput(dpy, wins[j][i], PropertyChangeMask);
+		}
+	}
+	XSync(dpy, False);
+	for(j = 0; j < NLAYOUTS; j++)
+		for(i = 0; i < nclients; i++) {
+			t = timeus();
+			XMapWindow(dpy, wins[j][i]);
+			XFlush(dpy);
+			waitmanaged(1);
+			samples[n++] = timeus() - t;
+		}
+	report("map", "", samples, n);
+}
+
+/* Switching from the empty desktop 0 costs mostly the arrange. */
+static void
+bencharrange(void) {
+	char keys[32];
+	unsigned long long t;
+	int i, j;
+
+	for(j = 0; j < NLAYOUTS; j++) {
+		for(i = 0; i < rounds; i++) {
+			view(0);
+			t = timeus();
+			view(j + 1);
+			samples[i] = timeus() - t;
+		}
+		snprintf(keys, sizeof(keys), "desktop=%d ", j + 1);
+		report("arrange", keys, samples, rounds);
+	}
+}
+
+/* Switching between two populated desktops bans and unbans everything. */
+static void
+benchview(void) {
+	unsigned long long t;
+	int i;
+
+	view(1);
+	for(i = 0; i < rounds; i++) {
+		t = timeus();
+		view(i % 2 ? 1 : 2);
+		samples[i] = timeus() - t;
+	}
+	report("view", "", samples, rounds);
+}
+
+/* Activates every client of desktop 1 in turn.  Rounds alternate in
+ * direction so the last window of a round is never the active one at its
+ * start. */
+static void
+benchfocus(void) {
+	unsigned long long t;
+	Window last;
+	int i, j;
+
+	if(nclients < 2)
+		return;
+	view(1);
+	sendmessage(wins[0][0], activewin, 1, CurrentTime);
+	XFlush(dpy);
+	waitroot(activewin, wins[0][0]);
+	t = timeus();
+	for(j = 0; j < rounds; j++) {
+		for(i = 1; i < nclients; i++)
+			sendmessage(wins[0][j % 2 ? nclients - 1 - i : i], activewin, 1,
+					CurrentTime);
+		last = wins[0][j % 2 ? 0 : nclients - 1];
+		XFlush(dpy);
+		waitroot(activewin, last);
+	}
+	t = timeus() - t;
+	printf("focus clients=%d activations=%d total_us=%llu per_sec=%.0f\n",
+			nclients, rounds * (nclients - 1), t,
+			rounds * (nclients - 1) * 1e6 / (t ? t : 1));
+	fflush(stdout);
+}
+
+int
+main(int argc, char *argv[]) {
+	pid_t pid;
+	int i, c;
+
+	while((c = getopt(argc, argv, "n:r:")) != -1)
+		switch(c) {
+		case 'n':
+			nclients = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			optind = argc + 1;
+		}
+	if(optind >= argc || nclients < 1 || rounds < 1)
+		eprint("usage: bench [-n clients] [-r rounds] wm [args ...]\n");
+	/* the server may still be starting */
+	for(i = 0; i < 50 && !(dpy = XOpenDisplay(0)); i++)
+		msleep(100);
+	if(!dpy)
+		eprint("bench: cannot open display\n");
+	screen = DefaultScreen(dpy);
+	root = RootWindow(dpy, screen);
+	curdesk = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
+	activewin = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
+	windesk = XInternAtom(dpy, "_NET_WM_DESKTOP", False);
+	XSelectInput(dpy, root, PropertyChangeMask);
+	samples = emallocz((NLAYOUTS * nclients + rounds) * sizeof(samples[0]));
+	signal(SIGALRM, timeout);
+
+	alarm(TIMEOUT);
+	pid = startwm(argv + optind);
+	alarm(TIMEOUT);
+	benchmap();
+	alarm(TIMEOUT);
+	bencharrange();
+	alarm(TIMEOUT);
+	benchview();
+	alarm(TIMEOUT);
+	benchfocus();
+	alarm(0);
+
+	/* let the window manager dump its own statistics to stderr */
+	kill(pid, SIGUSR1);
+	msleep(200);
+	kill(pid, SIGINT);
+	waitpid(pid, NULL, 0);
+	XCloseDisplay(dpy);
+	return 0;
+}
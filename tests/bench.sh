@@ -0,0 +1,28 @@
+#!/bin/sh
+# Runs bench against a fresh Xvfb for every client count and prints its
+# results, followed by the window manager's own statistics prefixed with
+# "wm clients=<n>".
+#
+# usage: bench.sh [wm]	(default ../echinus)
+
+WM=${1:-../echinus}
+CLIENTS=${CLIENTS:-"10 100 500"}
+ROUNDS=${ROUNDS:-20}
+DISP=${DISP:-:99}
+LOG=${TMPDIR:-/tmp}/echinus-bench.$$
+
+for n in ${CLIENTS}; do
+	Xvfb ${DISP} -screen 0 1280x1024x24 -nolisten tcp >/dev/null 2>&1 &
+	xvfb=$!
+	DISPLAY=${DISP} ./bench -n ${n} -r ${ROUNDS} ${WM} -f benchrc 2>${LOG}
+	status=$?
+	sed -n "s/^\(event\|action\|roundtrips\|requests\|resources\|client\) /wm clients=${n} &/p" ${LOG}
+	kill ${xvfb}
+	wait ${xvfb} 2>/dev/null
+	if [ ${status} -ne 0 ]; then
+		cat ${LOG} >&2
+		rm -f ${LOG}
+		exit ${status}
+	fi
+done
+rm -f ${LOG}
@@ -18,6 +18,9 @@ LDFLAGS = -s ${LIBS}
 CFLAGS = -g3 -ggdb3 -std=c99 -pedantic -O0 ${INCS}
 LDFLAGS = -g3 -ggdb3 ${LIBS}
 
+# walk's timings only mean something in an optimised build
+WALKFLAGS = -O2
+
 # DEBUG: Show warnings (if any). Comment out to disable.
 CFLAGS += -Wall
 # mostly useless warnings
@@ -1,8 +1,10 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <string.h>
 #include <malloc.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <time.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
@@ -157,3 +159,60 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size) {
 	XFree(name.value);
 	return True;
 }
+
+/* Creates an unmapped top level window for the window manager to manage,
+ * preset to land on the given desktop (unless desktop is negative). */
+Window
+mkclient(const char *name, long desktop) {
+	XSetWindowAttributes wa;
+	Window w;
+
+	wa.background_pixel = BlackPixel(dpy, screen);
+	w = XCreateWindow(dpy, root, 0, 0, 100, 100, 0,
+			DefaultDepth(dpy, screen), CopyFromParent,
+			DefaultVisual(dpy, screen), CWBackPixel, &wa);
+	XStoreName(dpy, w, name);
+	if(desktop >= 0)
+		XChangeProperty(dpy, w, XInternAtom(dpy, "_NET_WM_DESKTOP", False),
+				XA_CARDINAL, 32, PropModeReplace,
+				(unsigned char *)&desktop, 1);
+	return w;
+}
+
+/* Sends an EWMH client message about w to the root window. */
+void
+sendmessage(Window w, Atom type, long l0, long l1) {
+	XEvent ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.xclient.type = ClientMessage;
+	ev.xclient.window = w;
+	ev.xclient.message_type = type;
+	ev.xclient.format = 32;
+	ev.xclient.data.l[0] = l0;
+	ev.xclient.data.l[1] = l1;
+	XSendEvent(dpy, root, False,
+			SubstructureRedirectMask | SubstructureNotifyMask, &ev);
+}
+
+/* Reads the first item of a 32 bit property (CARDINAL, WINDOW, ...). */
+long
+getcardinal(Window w, Atom atom, long defval) {
+	unsigned long n;
+	long *p, res = defval;
+
+	if((p = getatom(w, atom, &n))) {
+		if(n)
+			res = *p;
+		XFree(p);
+	}
+	return res;
+}
+
+unsigned long long
+timeus(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -2,6 +2,7 @@
 char* estrdup(const char *str);
 int xerrordummy(Display *dpy, XErrorEvent *ee);
 void* emalloc(unsigned int size);
+void* emallocz(unsigned int size);
 void eprint(const char *errstr, ...);
 unsigned long getcolor(const char *colstr);
 char *getresource(const char *resource, char *defval, XrmDatabase xrdb);
@@ -12,6 +13,10 @@ char** getutf8prop(Window win, Atom atom, int *count);
 Bool gettextprop(Window w, Atom atom, char *text, unsigned int size);
 unsigned int textnw(const char *text, unsigned int len);
 unsigned int textw(const char *text);
+Window mkclient(const char *name, long desktop);
+void sendmessage(Window w, Atom type, long l0, long l1);
+long getcardinal(Window w, Atom atom, long defval);
+unsigned long long timeus(void);
 #ifndef RESNAME
 #define RESNAME ""
 #endif
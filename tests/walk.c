@@ -0,0 +1,204 @@
+/*
+ * walk - measures the client list walks without an X server
+ *
+ * Builds n clients twice, once laid out the way echinus did before the
+ * hot/cold split (one calloc()ed structure with the title inline and the
+ * tags in their own allocation) and once with allocclient() from
+ * ../pool.c, the allocator echinus uses, then times the passes arrange()
+ * and restack() make over them: a nexttiled() style walk over the client
+ * list and an isvisible() walk over the focus stack.  Results go to
+ * stdout in the same "metric key=value ..." records bench prints.
+ *
+ * It is built with WALKFLAGS (see config.mk) whatever CFLAGS says: at -O0
+ * the loads of the walk are lost among the rest.  At -O2 the split is
+ * about as fast as the old layout while the cache is warm, and 15-25%
+ * faster when it is cold.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+
+#include "../echinus.h"
+
+/* util.c, whose header clashes with echinus.h */
+unsigned long long timeus(void);
+
+#define NTAGS		9
+#define EVICTSIZE	(32 << 20)
+
+int screen;
+Display *dpy;
+Window root;
+unsigned int ntags = NTAGS;	/* for allocclient() */
+
+/* echinus' Client before the split */
+typedef struct OldClient OldClient;
+struct OldClient {
+	char name[256];
+	char *class;
+	char *skey;
+	int x, y, w, h;
+	int rx, ry, rw, rh;
+	int th;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	int minax, maxax, minay, maxay;
+	int ignoreunmap;
+	long flags;
+	int border, oldborder;
+	Bool isbanned, ismax, isfloating, wasfloating;
+	Bool isicon, isfill;
+	Bool isfixed, isbastard, isfocusable, hasstruts;
+	Bool *tags;
+	OldClient *next;
+	OldClient *prev;
+	OldClient *snext;
+	Window win;
+	Window title;
+	Window frame;
+	Pixmap drawable;
+	XftDraw *xftdraw;
+};
+
+static Bool seltags[NTAGS] = { True };
+static volatile unsigned long sink;
+
+/* What manage() did: the structure, its tags and its strings, in the
+ * order it allocated them. */
+static OldClient *
+mkold(int n) {
+	OldClient *c, *list = NULL;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		c = emallocz(sizeof(OldClient));
+		c->tags = emallocz(NTAGS * sizeof(Bool));
+		c->tags[i % 3] = True;
+		c->isfloating = i % 4 == 0;
+		c->frame = i + 1;
+		snprintf(c->name, sizeof(c->name), "client %d", i);
+		c->class = estrdup("Walk");
+		c->skey = estrdup("Walk client");
+		c->next = c->snext = list;
+		list = c;
+	}
+	return list;
+}
+
+/* What manage() does. */
+static Client *
+mknew(int n) {
+	Client *c, *list = NULL;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		c = allocclient();
+		c->tags[i % 3] = True;
+		c->isfloating = i % 4 == 0;
+		c->frame = i + 1;
+		c->cold->name = estrdup("client");
+		c->cold->class = estrdup("Walk");
+		c->cold->skey = estrdup("Walk client");
+		c->next = c->snext = list;
+		list = c;
+	}
+	return list;
+}
+
+/* The passes arrange() and restack() make: nexttiled() over the client
+ * list, then isvisible() over the focus stack.  Both layouts share the
+ * field names, so one body serves both. */
+#define WALK(_list) do {						\
+	for (c = (_list); c; c = c->next) {				\
+		if (c->isfloating || c->isicon || c->isbastard)		\
+			continue;					\
+		for (i = 0; i < NTAGS && !(c->tags[i] && seltags[i]); i++); \
+		s += i < NTAGS;						\
+	}								\
+	for (c = (_list); c; c = c->snext) {				\
+		for (i = 0; i < NTAGS && !(c->tags[i] && seltags[i]); i++); \
+		if (i < NTAGS)						\
+			s += c->frame;					\
+	}								\
+} while (0)
+
+/* Between events the clients and the X server push the window manager's
+ * data out of the caches, so with cold set every round starts after
+ * writing over a buffer larger than them. */
+static void
+evict(void) {
+	static unsigned char *junk;
+	size_t i;
+
+	if (!junk)
+		junk = emallocz(EVICTSIZE);
+	for (i = 0; i < EVICTSIZE; i += 64)
+		junk[i]++;
+}
+
+static unsigned long long
+walkold(OldClient *list, int rounds, Bool cold) {
+	OldClient *c;
+	unsigned long long t0, t = 0;
+	unsigned long s = 0;
+	int r, i;
+
+	for (r = 0; r < rounds; r++) {
+		if (cold)
+			evict();
+		t0 = timeus();
+		WALK(list);
+		t += timeus() - t0;
+	}
+	sink = s;
+	return t;
+}
+
+static unsigned long long
+walknew(Client *list, int rounds, Bool cold) {
+	Client *c;
+	unsigned long long t0, t = 0;
+	unsigned long s = 0;
+	int r, i;
+
+	for (r = 0; r < rounds; r++) {
+		if (cold)
+			evict();
+		t0 = timeus();
+		WALK(list);
+		t += timeus() - t0;
+	}
+	sink = s;
+	return t;
+}
+
+int
+main(int argc, char *argv[]) {
+	static const int counts[] = { 100, 300, 500, 1000, 5000 };
+	OldClient *ol;
+	Client *nl;
+	Bool cold;
+	int i, n, rounds = 200;
+
+	if (argc > 1 && (rounds = atoi(argv[1])) < 1)
+		eprint("usage: walk [rounds]\n");
+	printf("layout old_bytes=%u new_bytes=%u cold_bytes=%u\n",
+			(unsigned int) sizeof(OldClient), (unsigned int) sizeof(Client),
+			(unsigned int) sizeof(ClientCold));
+	for (i = 0; i < (int) (sizeof(counts) / sizeof(counts[0])); i++) {
+		n = counts[i];
+		ol = mkold(n);
+		nl = mknew(n);
+		for (cold = False; cold <= True; cold++)
+			printf("walk clients=%d rounds=%d cache=%s old_ns=%.1f new_ns=%.1f\n",
+					n, rounds, cold ? "cold" : "warm",
+					walkold(ol, rounds, cold) * 1e3 / ((double) rounds * n),
+					walknew(nl, rounds, cold) * 1e3 / ((double) rounds * n));
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,605 @@
+/*
+ *  echinus wm written by Alexander Polakov <polachok@gmail.com>
+ *  this file contains event trace recording and replay
+ *
+ *  With -r every event handed to a handler, including the ones eaten by
+ *  modal loops like mousemove(), goes to a trace file together with the
+ *  properties the handlers are going to read.  The clients present at
+ *  startup are written as if they had just been mapped.
+ *
+ *  With -R the trace is fed straight into handler[] instead of running the
+ *  event loop.  Clients are played by stand-in windows owned by a second
+ *  connection, window ids and atoms are translated to the ones of the
+ *  replaying server and everything the server sends on its own is dropped,
+ *  so two builds see exactly the same input.  Events follow each other as
+ *  fast as they are handled, not at the recorded pace, so the ratelimit
+ *  and titlerate throttles, which go by the clock, are off while
+ *  replaying.  At the end the timing and the statistics of stats.c are
+ *  written to stdout.
+ *
+ *  The file is in host byte order: records are a kind byte and the time
+ *  since the previous record in microseconds, followed by
+ *	'E' size, event bytes, atom names (see eventatoms())
+ *	'C' window, x, y, width, height, border (stand-in window)
+ *	'P' window, atom, type ("" if deleted), format, count, data
+ *	'W' window, frame, title (what manage() made of a client, again
+ *	    whenever it gets a new title window)
+ *  Atom names are 16 bit length prefixed strings.
+ */
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+#include "echinus.h"
+#include "config.h"
+
+#undef XMaskEvent
+
+#define TRACEMAGIC	"ECHTRACE"
+#define TRACEVERSION	2
+
+typedef struct {
+	Window from, to;
+} WinMap;
+
+static FILE *trace;
+static Bool replaying;
+static unsigned long long last;		/* time of the previous record */
+static Window traceroot;		/* root of the recorded session */
+
+/* replay state */
+static Display *sdpy;			/* owns the stand-in windows */
+static WinMap *winmap;
+static unsigned int nwinmap, winmapsize;
+static unsigned long long recorded;	/* length of the recorded session */
+
+static const size_t evsize[LASTEvent] = {
+	[KeyPress] = sizeof(XKeyEvent),
+	[KeyRelease] = sizeof(XKeyEvent),
+	[ButtonPress] = sizeof(XButtonEvent),
+	[ButtonRelease] = sizeof(XButtonEvent),
+	[MotionNotify] = sizeof(XMotionEvent),
+	[EnterNotify] = sizeof(XCrossingEvent),
+	[LeaveNotify] = sizeof(XCrossingEvent),
+	[FocusIn] = sizeof(XFocusChangeEvent),
+	[FocusOut] = sizeof(XFocusChangeEvent),
+	[Expose] = sizeof(XExposeEvent),
+	[DestroyNotify] = sizeof(XDestroyWindowEvent),
+	[UnmapNotify] = sizeof(XUnmapEvent),
+	[MapNotify] = sizeof(XMapEvent),
+	[MapRequest] = sizeof(XMapRequestEvent),
+	[ReparentNotify] = sizeof(XReparentEvent),
+	[ConfigureNotify] = sizeof(XConfigureEvent),
+	[ConfigureRequest] = sizeof(XConfigureRequestEvent),
+	[PropertyNotify] = sizeof(XPropertyEvent),
+	[ClientMessage] = sizeof(XClientMessageEvent),
+	[MappingNotify] = sizeof(XMappingEvent),
+};
+
+static void
+put(const void *p, size_t n) {
+	if (fwrite(p, 1, n, trace) != n)
+		eprint("echinus: cannot write trace\n");
+}
+
+static void
+put32(unsigned long v) {
+	unsigned int u = v;
+
+	put(&u, sizeof(u));
+}
+
+static void
+putname(Atom a) {
+	char *name = a ? XGetAtomName(dpy, a) : NULL;
+	unsigned short len = name ? strlen(name) : 0;
+
+	put(&len, sizeof(len));
+	put(name, len);
+	if (name)
+		XFree(name);
+}
+
+static void
+putrecord(char kind) {
+	unsigned long long now = timeus();
+
+	put(&kind, 1);
+	put32(last ? now - last : 0);
+	last = now;
+}
+
+static void
+get(void *p, size_t n) {
+	if (fread(p, 1, n, trace) != n)
+		eprint("echinus: truncated trace\n");
+}
+
+static unsigned long
+get32(void) {
+	unsigned int u;
+
+	get(&u, sizeof(u));
+	return u;
+}
+
+static Atom
+getname(void) {
+	char name[256];
+	unsigned short len;
+
+	get(&len, sizeof(len));
+	if (len >= sizeof(name))
+		eprint("echinus: corrupt trace\n");
+	get(name, len);
+	name[len] = '\0';
+	return len ? XInternAtom(dpy, name, False) : None;
+}
+
+/* The atoms of an event that have to be written by name: the message type
+ * of client messages, the state atoms of _NET_WM_STATE requests and the
+ * property of property notifications. */
+static int
+eventatoms(XEvent * ev, Atom ** slot) {
+	switch (ev->type) {
+	case ClientMessage:
+		slot[0] = &ev->xclient.message_type;
+		if (ev->xclient.message_type != atom[WindowState])
+			return 1;
+		slot[1] = (Atom *) & ev->xclient.data.l[1];
+		slot[2] = (Atom *) & ev->xclient.data.l[2];
+		return 3;
+	case PropertyNotify:
+		slot[0] = &ev->xproperty.atom;
+		return 1;
+	}
+	return 0;
+}
+
+static void
+recordcreate(Window w, int x, int y, int width, int height, int border) {
+	putrecord('C');
+	put32(w);
+	put32(x);
+	put32(y);
+	put32(width);
+	put32(height);
+	put32(border);
+}
+
+static void
+recordproperty(Window w, Atom prop) {
+	unsigned char *data = NULL;
+	unsigned long i, n, extra;
+	int format;
+	char f;
+	Atom type;
+
+	if (XGetWindowProperty(dpy, w, prop, 0L, 0x7fffffffL, False,
+		AnyPropertyType, &type, &format, &n, &extra, &data) != Success)
+		type = None;
+	putrecord('P');
+	put32(w);
+	putname(prop);
+	putname(type);
+	if (type == None) {
+		if (data)
+			XFree(data);
+		return;
+	}
+	f = format;
+	put(&f, 1);
+	put32(n);
+	for (i = 0; i < n; i++)
+		switch (format) {
+		case 8:
+			put(&data[i], 1);
+			break;
+		case 16:
+			put(&((short *) data)[i], sizeof(short));
+			break;
+		default:	/* Xlib hands out 32 bit items as longs */
+			if (type == XA_ATOM)
+				putname(((Atom *) data)[i]);
+			else
+				put32(((long *) data)[i]);
+		}
+	XFree(data);
+}
+
+static void
+recordwindow(Window w) {
+	XWindowAttributes wa;
+	Atom *props;
+	int i, n;
+
+	if (!XGetWindowAttributes(dpy, w, &wa))
+		return;
+	recordcreate(w, wa.x, wa.y, wa.width, wa.height, wa.border_width);
+	if (!(props = XListProperties(dpy, w, &n)))
+		return;
+	for (i = 0; i < n; i++)
+		recordproperty(w, props[i]);
+	XFree(props);
+}
+
+static void
+recordevent(XEvent * ev) {
+	XEvent tmp = *ev;
+	Atom *slot[3];
+	int i, n;
+
+	/* keycodes differ between servers, keysyms do not */
+	if (tmp.type == KeyPress || tmp.type == KeyRelease)
+		tmp.xkey.keycode = XLookupKeysym(&ev->xkey, 0);
+	/* so are serials; keep what enternotify() makes of them */
+	if (tmp.type == EnterNotify)
+		tmp.xcrossing.serial = ev->xcrossing.serial < enterserial ? 0 : ~0UL;
+	putrecord('E');
+	put32(evsize[tmp.type]);
+	put(&tmp, evsize[tmp.type]);
+	n = eventatoms(&tmp, slot);
+	for (i = 0; i < n; i++)
+		putname(*slot[i]);
+}
+
+void
+traceevent(XEvent * ev) {
+	XConfigureRequestEvent *cr = &ev->xconfigurerequest;
+
+	if (!trace || replaying || ev->type >= LASTEvent || !evsize[ev->type])
+		return;
+	switch (ev->type) {
+	case MapRequest:
+		recordwindow(ev->xmaprequest.window);
+		break;
+	case ConfigureRequest:
+		if (!getclient(cr->window, clients, ClientWindow))
+			recordcreate(cr->window, cr->x, cr->y, cr->width,
+			    cr->height, cr->border_width);
+		break;
+	case PropertyNotify:
+		recordproperty(ev->xproperty.window, ev->xproperty.atom);
+		break;
+	}
+	recordevent(ev);
+}
+
+void
+tracemanage(Client * c) {
+	if (!trace || replaying)
+		return;
+	putrecord('W');
+	put32(c->win);
+	put32(c->frame);
+	put32(c->title);
+}
+
+/* Writes the clients managed by scan() as if they had just been mapped,
+ * oldest first so that replaying them rebuilds the same client list. */
+void
+tracestart(void) {
+	XEvent ev;
+	Client *c;
+
+	if (!trace || replaying || !clients)
+		return;
+	for (c = clients; c->next; c = c->next);
+	for (; c; c = c->prev) {
+		recordwindow(c->win);
+		memset(&ev, 0, sizeof(ev));
+		ev.type = MapRequest;
+		ev.xmaprequest.parent = root;
+		ev.xmaprequest.window = c->win;
+		recordevent(&ev);
+		tracemanage(c);
+	}
+}
+
+static void
+addwinmap(Window from, Window to) {
+	if (nwinmap == winmapsize) {
+		winmapsize = winmapsize ? winmapsize * 2 : 64;
+		if (!(winmap = realloc(winmap, winmapsize * sizeof(WinMap))))
+			eprint("fatal: could not realloc() %u bytes\n",
+			    (unsigned int)(winmapsize * sizeof(WinMap)));
+	}
+	winmap[nwinmap].from = from;
+	winmap[nwinmap++].to = to;
+}
+
+static WinMap *
+findwinmap(Window from) {
+	unsigned int i;
+
+	for (i = 0; i < nwinmap; i++)
+		if (winmap[i].from == from)
+			return &winmap[i];
+	return NULL;
+}
+
+/* Titles come and go, see createtitle(). */
+static void
+setwinmap(Window from, Window to) {
+	WinMap *wm;
+
+	if ((wm = findwinmap(from)))
+		wm->to = to;
+	else
+		addwinmap(from, to);
+}
+
+/* Windows nobody told us about keep their id. */
+static Window
+mapwin(Window w) {
+	WinMap *wm;
+
+	if (w == traceroot)
+		return root;
+	return (wm = findwinmap(w)) ? wm->to : w;
+}
+
+static void
+replaycreate(void) {
+	XSetWindowAttributes wa;
+	Window from;
+	int x, y, w, h, b;
+
+	from = get32();
+	x = (int) get32();
+	y = (int) get32();
+	w = get32();
+	h = get32();
+	b = get32();
+	if (findwinmap(from))
+		return;
+	wa.background_pixel = BlackPixel(sdpy, screen);
+	addwinmap(from, XCreateWindow(sdpy, RootWindow(sdpy, screen), x, y,
+		max(w, 1), max(h, 1), b, CopyFromParent, InputOutput,
+		CopyFromParent, CWBackPixel, &wa));
+	XSync(sdpy, False);
+}
+
+static void
+replayproperty(void) {
+	unsigned long i, n;
+	unsigned char *data = NULL;
+	Window w;
+	Atom prop, type;
+	char format;
+
+	w = get32();
+	prop = getname();
+	if (!(type = getname())) {
+		if (w == traceroot || findwinmap(w))
+			XDeleteProperty(sdpy, mapwin(w), prop);
+		XSync(sdpy, False);
+		return;
+	}
+	get(&format, 1);
+	if (format != 8 && format != 16 && format != 32)
+		eprint("echinus: corrupt trace\n");
+	n = get32();
+	data = emallocz(max(n, 1) * (format == 32 ? sizeof(long) : format / 8));
+	for (i = 0; i < n; i++)
+		switch (format) {
+		case 8:
+			get(&data[i], 1);
+			break;
+		case 16:
+			get(&((short *) data)[i], sizeof(short));
+			break;
+		default:
+			if (type == XA_ATOM)
+				((Atom *) data)[i] = getname();
+			else if (type == XA_WINDOW)
+				((long *) data)[i] = mapwin(get32());
+			else
+				((long *) data)[i] = (int) get32();
+		}
+	if (w == traceroot || findwinmap(w)) {
+		XChangeProperty(sdpy, mapwin(w), prop, type, format,
+		    PropModeReplace, data, n);
+		XSync(sdpy, False);
+	}
+	free(data);
+}
+
+static void
+replayframe(void) {
+	Window w, frame, title;
+	Client *c;
+
+	w = get32();
+	frame = get32();
+	title = get32();
+	if (!(c = getclient(mapwin(w), clients, ClientWindow)))
+		return;
+	setwinmap(frame, c->frame);
+	if (title && c->title)
+		setwinmap(title, c->title);
+}
+
+static void
+replayevent(XEvent * ev) {
+	Atom *slot[3];
+	size_t size;
+	int i, n;
+
+	if ((size = get32()) > sizeof(XEvent))
+		eprint("echinus: corrupt trace\n");
+	memset(ev, 0, sizeof(XEvent));
+	get(ev, size);
+	if (ev->type >= LASTEvent || evsize[ev->type] != size)
+		eprint("echinus: corrupt trace\n");
+	ev->xany.display = dpy;
+	ev->xany.send_event = False;
+	if (eventatoms(ev, slot))
+		*slot[0] = getname();
+	/* the message type decides which other atoms follow */
+	n = eventatoms(ev, slot);
+	for (i = 1; i < n; i++)
+		*slot[i] = getname();
+	switch (ev->type) {
+	case KeyPress:
+	case KeyRelease:
+		ev->xkey.keycode = XKeysymToKeycode(dpy, ev->xkey.keycode);
+		/* fall through */
+	case ButtonPress:
+	case ButtonRelease:
+	case MotionNotify:
+	case EnterNotify:
+	case LeaveNotify:
+		/* all of these start like XKeyEvent */
+		ev->xkey.window = mapwin(ev->xkey.window);
+		ev->xkey.root = root;
+		ev->xkey.subwindow = mapwin(ev->xkey.subwindow);
+		break;
+	case MapRequest:
+		ev->xmaprequest.parent = mapwin(ev->xmaprequest.parent);
+		ev->xmaprequest.window = mapwin(ev->xmaprequest.window);
+		break;
+	case ConfigureRequest:
+		ev->xconfigurerequest.parent = mapwin(ev->xconfigurerequest.parent);
+		ev->xconfigurerequest.window = mapwin(ev->xconfigurerequest.window);
+		ev->xconfigurerequest.above = mapwin(ev->xconfigurerequest.above);
+		break;
+	case DestroyNotify:
+	case UnmapNotify:
+	case MapNotify:
+		/* event, window */
+		ev->xdestroywindow.event = mapwin(ev->xdestroywindow.event);
+		ev->xdestroywindow.window = mapwin(ev->xdestroywindow.window);
+		break;
+	case ReparentNotify:
+		ev->xreparent.event = mapwin(ev->xreparent.event);
+		ev->xreparent.window = mapwin(ev->xreparent.window);
+		ev->xreparent.parent = mapwin(ev->xreparent.parent);
+		break;
+	case ConfigureNotify:
+		ev->xconfigure.event = mapwin(ev->xconfigure.event);
+		ev->xconfigure.window = mapwin(ev->xconfigure.window);
+		ev->xconfigure.above = mapwin(ev->xconfigure.above);
+		break;
+	default:
+		ev->xany.window = mapwin(ev->xany.window);
+	}
+}
+
+/* Applies records up to the next event.  Returns False at the end. */
+static Bool
+replaynext(XEvent * ev) {
+	int kind;
+
+	while ((kind = fgetc(trace)) != EOF) {
+		recorded += get32();
+		switch (kind) {
+		case 'C':
+			replaycreate();
+			break;
+		case 'P':
+			replayproperty();
+			break;
+		case 'W':
+			replayframe();
+			break;
+		case 'E':
+			replayevent(ev);
+			return True;
+		default:
+			eprint("echinus: corrupt trace\n");
+		}
+	}
+	return False;
+}
+
+/* XMaskEvent() as seen by the modal loops (see echinus.h). */
+int
+tracemaskevent(Display * d, long mask, XEvent * ev) {
+	if (replaying) {
+		if (!replaynext(ev))
+			eprint("echinus: trace ends inside a modal loop\n");
+		return 0;
+	}
+	XMaskEvent(d, mask, ev);
+	traceevent(ev);
+	return 0;
+}
+
+void
+replay(void) {
+	unsigned long long t;
+	unsigned long n = 0;
+	XEvent ev, junk;
+	StatsMark sm;
+	WinMap *wm;
+
+	/* throttling by the clock would make every replay differ */
+	options.ratelimit = 0;
+	options.titlerate = 0;
+	t = timeus();
+	while (replaynext(&ev)) {
+		n++;
+		if (handler[ev.type]) {
+			statsbegin(&sm);
+			(handler[ev.type]) (&ev);
+			statsevent(ev.type, &sm);
+		}
+		if (ev.type == DestroyNotify)
+			for (wm = winmap; wm < winmap + nwinmap; wm++)
+				if (wm->to == ev.xdestroywindow.window) {
+					XDestroyWindow(sdpy, wm->to);
+					*wm = winmap[--nwinmap];
+					break;
+				}
+		runtimers();
+		/* only the trace drives the handlers */
+		XSync(dpy, False);
+		while (XPending(dpy))
+			XNextEvent(dpy, &junk);
+	}
+	t = timeus() - t;
+	XSync(dpy, False);
+	while (XPending(dpy))
+		XNextEvent(dpy, &junk);
+	printf("replay events=%lu total_us=%llu recorded_us=%llu\n", n,
+	    t, recorded);
+	statsdump(stdout);
+}
+
+void
+traceopen(const char *path, Bool replay) {
+	char magic[sizeof(TRACEMAGIC) - 1];
+
+	if (!(trace = fopen(path, replay ? "r" : "w")))
+		eprint("echinus: cannot open %s\n", path);
+	replaying = replay;
+	if (!replaying) {
+		put(TRACEMAGIC, sizeof(magic));
+		put32(TRACEVERSION);
+		put32(root);
+		return;
+	}
+	get(magic, sizeof(magic));
+	if (memcmp(magic, TRACEMAGIC, sizeof(magic)) || get32() != TRACEVERSION)
+		eprint("echinus: %s is not a trace\n", path);
+	traceroot = get32();
+	if (!(sdpy = XOpenDisplay(0)))
+		eprint("echinus: cannot open display\n");
+}
+
+void
+traceclose(void) {
+	if (!trace)
+		return;
+	fclose(trace);
+	trace = NULL;
+	if (sdpy)
+		XCloseDisplay(sdpy);
+	sdpy = NULL;
+}